@@ -0,0 +1,151 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.14
+
+#include "backtrack_format.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace fq {
+
+int FormatParser::Parse(const std::string& str, BacktrackFormat& format) {
+  FormatRootNode root;
+  int ret = Parse(str, root);
+  if (ret != 0) {
+    return ret;
+  }
+  return format.Compile(root);
+}
+
+int BacktrackFormat::Compile(const FormatRootNode& root, MatchPolicy policy) {
+  elements_.clear();
+  literals_.clear();
+  fields_.clear();
+  policies_.clear();
+  names_ = NameTable();
+
+  for (auto& element: root.GetElements()) {
+    if (element->IsLiteral()) {
+      auto literal = static_cast<const FormatLiteralNode*>(element.get());
+      literals_.emplace_back(literal->GetToken().GetString());
+      elements_.push_back(Element{true, (int) literals_.size() - 1});
+      continue;
+    }
+    auto matcher = dynamic_cast<const FormatMatcherNode*>(element.get());
+    if (matcher == nullptr || matcher->GetDecl() || matcher->GetName().IsEmpty()) {
+      return -14;
+    }
+    auto name = matcher->GetName().GetString();
+    fields_.push_back(FieldInfo{std::string(name), std::string(matcher->GetType().GetString()), matcher->GetFieldType(),
+                                names_.Intern(name), matcher->GetWidth()});
+    policies_.push_back(policy);
+    elements_.push_back(Element{false, (int) fields_.size() - 1});
+  }
+  return 0;
+}
+
+int BacktrackFormat::SetPolicy(std::string_view name, MatchPolicy policy) {
+  int slot = names_.Find(name);
+  if (slot < 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < fields_.size(); ++i) {
+    if (fields_[i].slot == slot) {
+      policies_[i] = policy;
+    }
+  }
+  return 0;
+}
+
+bool BacktrackFormat::Match(std::string_view s, MatchResult& result) const {
+  result.Reset(&names_);
+  const int n     = (int) s.size();
+  const int k     = (int) elements_.size();
+  const int width = n + 1;
+
+  // reach[i * width + p]: 第 i 个元素及之后能否恰好匹配 s[p, n)
+  thread_local std::vector<uint8_t> reach;
+  reach.assign((size_t) (k + 1) * width, 0);
+  auto row = [&](int i) { return reach.data() + (size_t) i * width; };
+  row(k)[n] = 1;
+
+  FieldValue typed;
+  for (int i = k - 1; i >= 0; --i) {
+    uint8_t* cur        = row(i);
+    const uint8_t* next = row(i + 1);
+    const Element& element = elements_[i];
+    if (element.literal) {
+      const std::string& literal = literals_[element.index];
+      int size = (int) literal.size();
+      for (int p = 0; p + size <= n; ++p) {
+        cur[p] = next[p + size] && s.compare(p, size, literal) == 0;
+      }
+    } else if (fields_[element.index].width > 0) {
+      const FieldInfo& field = fields_[element.index];
+      for (int p = 0; p + field.width <= n; ++p) {
+        cur[p] = next[p + field.width] &&
+                 ConvertField(field.field_type, TrimFixedField(field.field_type, s.substr(p, field.width)), typed);
+      }
+    } else if (fields_[element.index].field_type == kFieldTypeStr) {
+      uint8_t any = 0;
+      for (int p = n; p >= 0; --p) {
+        any |= next[p];
+        cur[p] = any;
+      }
+    } else {
+      FieldType type = fields_[element.index].field_type;
+      for (int p = 0; p <= n; ++p) {
+        int end = std::min(n, p + kMaxNumberWidth);
+        for (int q = p; q <= end && !cur[p]; ++q) {
+          cur[p] = next[q] && ConvertField(type, s.substr(p, q - p), typed);
+        }
+      }
+    }
+  }
+  if (!row(0)[0]) {
+    return false;
+  }
+
+  // 每一步都选择策略允许的第一个可行位置, reach 保证一定存在
+  int p = 0;
+  for (int i = 0; i < k; ++i) {
+    const Element& element = elements_[i];
+    if (element.literal) {
+      p += (int) literals_[element.index].size();
+      continue;
+    }
+    const FieldInfo& field = fields_[element.index];
+    if (field.width > 0) {
+      // reach 保证定宽的值可以转换
+      auto value = TrimFixedField(field.field_type, s.substr(p, field.width));
+      ConvertField(field.field_type, value, typed);
+      result.Set(field.slot, field.name, field.type, value, typed);
+      p += field.width;
+      continue;
+    }
+    const uint8_t* next    = row(i + 1);
+    int end = field.field_type == kFieldTypeStr ? n : std::min(n, p + kMaxNumberWidth);
+    int q   = -1;
+    if (policies_[element.index] == kPolicyGreedy) {
+      for (q = end; q >= p; --q) {
+        if (next[q] && ConvertField(field.field_type, s.substr(p, q - p), typed)) {
+          break;
+        }
+      }
+    } else {
+      for (q = p; q <= end; ++q) {
+        if (next[q] && ConvertField(field.field_type, s.substr(p, q - p), typed)) {
+          break;
+        }
+      }
+    }
+    result.Set(field.slot, field.name, field.type, s.substr(p, q - p), typed);
+    p = q;
+  }
+  return true;
+}
+
+}  // namespace fq
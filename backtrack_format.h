@@ -0,0 +1,61 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.14
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "compiled_format.h"
+
+namespace fq {
+
+// 字段在有多种切分时的取舍
+enum MatchPolicy {
+  kPolicyLazy   = 0,  // 尽量短, 与 FormatRootNode::Handle 取文本第一次出现的位置一致
+  kPolicyGreedy = 1,  // 尽量长
+};
+
+// 带回溯语义的匹配: 整行必须被完整匹配, 文本可以出现在字段值中
+//   "{a}-{b}-{c}" 匹配 "x-y-z-w" 时, Handle 只看文本第一次出现的位置, 这里会尝试所有切分
+// 按字段顺序依次取策略允许的第一种可行切分, 结果与回溯一致, 但时间是线性的:
+//   从后往前计算 reach[i][p]: 第 i 个元素及之后能否恰好匹配 s[p, n)
+//   str 字段可以是任意子串, reach 为后一行的后缀或; 数值字段最多 kMaxNumberWidth 个字节
+//   之后从前往后按策略选择, 每一步都保证剩余部分可以匹配
+// 只支持由文本和普通字段组成的 format, 不支持 decl
+class BacktrackFormat {
+ public:
+  BacktrackFormat() = default;
+
+  // 返回 -14 format 中有 decl 或没有名字的字段; 相邻的字段可以编译, 由回溯决定切分
+  int Compile(const FormatRootNode& root, MatchPolicy policy = kPolicyLazy);
+
+  // 同名的字段都会被设置, 找不到返回 -1
+  int SetPolicy(std::string_view name, MatchPolicy policy);
+
+  // result 会先被 Reset 并绑定到本 format 的名字表
+  bool Match(std::string_view s, MatchResult& result) const;
+
+  const NameTable& GetNameTable() const { return names_; }
+
+  // 数值字段的最大长度, 更长的值不会被当成数值
+  static constexpr int kMaxNumberWidth = 64;
+
+ private:
+  struct Element {
+    // 文本为 literals_ 下标, 否则为 fields_ 下标
+    bool literal;
+    int index;
+  };
+
+  std::vector<Element> elements_;
+  std::vector<std::string> literals_;
+  std::vector<FieldInfo> fields_;
+  std::vector<MatchPolicy> policies_;
+  NameTable names_;
+};
+
+}  // namespace fq
@@ -0,0 +1,148 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.14
+
+#include "backtrack_format.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace fq;
+
+static std::string Value(const MatchResult& result, std::string_view name) {
+  auto item = result.Get(name);
+  if (item == nullptr) {
+    return "<null>";
+  }
+  return std::string(item->value_);
+}
+
+// 朴素的回溯, 用于对比
+static bool Backtrack(std::string_view s, size_t p, const std::vector<std::string>& parts, size_t i,
+                      const std::vector<bool>& greedy, std::vector<std::string>& values) {
+  if (i == parts.size()) {
+    return p == s.size();
+  }
+  if (parts[i][0] != '{') {
+    return s.compare(p, parts[i].size(), parts[i]) == 0 &&
+           Backtrack(s, p + parts[i].size(), parts, i + 1, greedy, values);
+  }
+  bool is_int = parts[i] == "{int}";
+  for (size_t n = 0; n <= s.size() - p; ++n) {
+    size_t size = greedy[i] ? s.size() - p - n : n;
+    auto value  = s.substr(p, size);
+    FieldValue typed;
+    if (is_int && !ConvertField(kFieldTypeInt, value, typed)) {
+      continue;
+    }
+    values[i] = std::string(value);
+    if (Backtrack(s, p + size, parts, i + 1, greedy, values)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST(BacktrackFormat, Match)
+{
+  FormatParser parser;
+  BacktrackFormat format;
+  ASSERT_EQ(parser.Parse("{a}-{b}-{c}", format), 0);
+
+  MatchResult result;
+  EXPECT_TRUE(format.Match("x-y-z-w", result));
+  EXPECT_EQ(Value(result, "a"), "x");
+  EXPECT_EQ(Value(result, "b"), "y");
+  EXPECT_EQ(Value(result, "c"), "z-w");
+
+  EXPECT_EQ(format.SetPolicy("a", kPolicyGreedy), 0);
+  EXPECT_EQ(format.SetPolicy("nope", kPolicyGreedy), -1);
+  EXPECT_TRUE(format.Match("x-y-z-w", result));
+  EXPECT_EQ(Value(result, "a"), "x-y");
+  EXPECT_EQ(Value(result, "b"), "z");
+  EXPECT_EQ(Value(result, "c"), "w");
+  EXPECT_FALSE(format.Match("x-y", result));
+
+  // 类型不对时回溯
+  ASSERT_EQ(parser.Parse("{path}-{id:int}.log", format), 0);
+  EXPECT_TRUE(format.Match("app-2022-04-14-17.log", result));
+  EXPECT_EQ(Value(result, "path"), "app-2022-04-14");
+  EXPECT_EQ(result.Get("id")->typed_.i, 17);
+  EXPECT_FALSE(format.Match("app-2022-04-14-x.log", result));
+
+  // 定宽字段只有一种切分
+  ASSERT_EQ(parser.Parse("{path}-{id:int:03}{tail}", format), 0);
+  EXPECT_TRUE(format.Match("a-b- 17x-y", result));
+  EXPECT_EQ(Value(result, "path"), "a-b");
+  EXPECT_EQ(result.Get("id")->typed_.i, 17);
+  EXPECT_EQ(Value(result, "tail"), "x-y");
+
+  EXPECT_EQ(parser.Parse("{a}|{Raw({b})}", format), -14);
+}
+
+TEST(BacktrackFormat, SameAsBacktrack)
+{
+  std::vector<std::string> parts = {"{str}", "-", "{int}", "-", "{str}", "x", "{str}"};
+  std::string text;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (parts[i][0] == '{') {
+      names.push_back("f" + std::to_string(i));
+      text += "{" + names.back() + (parts[i] == "{int}" ? ":int}" : "}");
+    } else {
+      text += parts[i];
+    }
+  }
+
+  std::mt19937 rng(20220414);
+  for (int round = 0; round < 2000; ++round) {
+    std::vector<bool> greedy(parts.size());
+    FormatParser parser;
+    BacktrackFormat format;
+    ASSERT_EQ(parser.Parse(text, format), 0);
+    for (size_t i = 0; i < parts.size(); ++i) {
+      greedy[i] = rng() % 2 == 0;
+      if (parts[i][0] == '{') {
+        format.SetPolicy("f" + std::to_string(i), greedy[i] ? kPolicyGreedy : kPolicyLazy);
+      }
+    }
+    std::string s(rng() % 12, ' ');
+    for (auto& ch : s) {
+      ch = "-x12"[rng() % 4];
+    }
+
+    std::vector<std::string> values(parts.size());
+    bool expected = Backtrack(s, 0, parts, 0, greedy, values);
+    MatchResult result;
+    ASSERT_EQ(format.Match(s, result), expected) << s;
+    if (expected) {
+      for (size_t i = 0; i < parts.size(); ++i) {
+        if (parts[i][0] == '{') {
+          ASSERT_EQ(Value(result, "f" + std::to_string(i)), values[i]) << s << " field " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(BacktrackFormat, Adversarial)
+{
+  FormatParser parser;
+  BacktrackFormat format;
+  ASSERT_EQ(parser.Parse("{a}-{b}-{c}-{d}-{e}-{f}!", format), 0);
+  // 朴素回溯需要 O(n^5)
+  std::string s(200000, '-');
+  MatchResult result;
+  EXPECT_FALSE(format.Match(s, result));
+  s.back() = '!';
+  EXPECT_TRUE(format.Match(s, result));
+  EXPECT_EQ(Value(result, "a"), "");
+  EXPECT_EQ(Value(result, "f").size(), s.size() - 6);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,235 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.06
+
+#include "base64.h"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FQ_HAVE_X86 1
+#endif
+
+namespace fq {
+
+namespace {
+
+constexpr size_t kInvalid = std::string::npos;
+// 向量写入时会多写几个字节
+constexpr size_t kSlack = 8;
+
+struct DecodeTable {
+  int8_t value[256];
+
+  constexpr DecodeTable() : value() {
+    for (int i = 0; i < 256; ++i) {
+      value[i] = -1;
+    }
+    for (int i = 0; i < 26; ++i) {
+      value['A' + i] = (int8_t) i;
+      value['a' + i] = (int8_t) (26 + i);
+    }
+    for (int i = 0; i < 10; ++i) {
+      value['0' + i] = (int8_t) (52 + i);
+    }
+    value['+'] = 62;
+    value['/'] = 63;
+  }
+};
+
+constexpr DecodeTable kDecode;
+
+// 解码 n 个字符(不含填充), 返回写入的字节数, 输入非法返回 kInvalid
+size_t DecodeScalar(const char* in, size_t n, char* out) {
+  char* p  = out;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    int a = kDecode.value[(uint8_t) in[i]];
+    int b = kDecode.value[(uint8_t) in[i + 1]];
+    int c = kDecode.value[(uint8_t) in[i + 2]];
+    int d = kDecode.value[(uint8_t) in[i + 3]];
+    if ((a | b | c | d) < 0) {
+      return kInvalid;
+    }
+    uint32_t v = (uint32_t) a << 18 | (uint32_t) b << 12 | (uint32_t) c << 6 | (uint32_t) d;
+    *p++ = (char) (v >> 16);
+    *p++ = (char) (v >> 8);
+    *p++ = (char) v;
+  }
+
+  // 不完整的最后一组: 2 个字符得到 1 个字节, 3 个字符得到 2 个字节
+  size_t rest = n - i;
+  if (rest == 1) {
+    return kInvalid;
+  }
+  if (rest >= 2) {
+    int a = kDecode.value[(uint8_t) in[i]];
+    int b = kDecode.value[(uint8_t) in[i + 1]];
+    int c = rest == 3 ? kDecode.value[(uint8_t) in[i + 2]] : 0;
+    if ((a | b | c) < 0) {
+      return kInvalid;
+    }
+    uint32_t v = (uint32_t) a << 18 | (uint32_t) b << 12 | (uint32_t) c << 6;
+    *p++ = (char) (v >> 16);
+    if (rest == 3) {
+      *p++ = (char) (v >> 8);
+    }
+  }
+  return p - out;
+}
+
+#ifdef FQ_HAVE_X86
+
+// lo <= v <= hi 的字节为 0xff, 按有符号比较, 所以 >= 0x80 的字节都不在范围内
+inline __m128i InRange(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
+
+__attribute__((target("avx2"))) inline __m256i InRange(__m256i v, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+// 先按字符范围分类, 每类加上各自的偏移得到 6 位的值
+// 再用乘加把 4 个 6 位拼成 24 位, 最后用 pshufb 去掉每 4 字节中的空字节并调整字节序
+__attribute__((target("ssse3"))) size_t DecodeSsse3(const char* in, size_t n, char* out) {
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  char* p  = out;
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v     = _mm_loadu_si128((const __m128i*) (in + i));
+    __m128i upper = InRange(v, 'A', 'Z');
+    __m128i lower = InRange(v, 'a', 'z');
+    __m128i digit = InRange(v, '0', '9');
+    __m128i plus  = _mm_cmpeq_epi8(v, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(v, _mm_set1_epi8('/'));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      return kInvalid;
+    }
+    __m128i shift = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)), _mm_and_si128(lower, _mm_set1_epi8(-71))),
+        _mm_or_si128(_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(4)), _mm_and_si128(plus, _mm_set1_epi8(19))),
+                     _mm_and_si128(slash, _mm_set1_epi8(16))));
+    v = _mm_add_epi8(v, shift);
+
+    // [a, b, c, d] -> a << 6 | b, c << 6 | d -> a << 18 | b << 12 | c << 6 | d
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128((__m128i*) p, _mm_shuffle_epi8(v, pack));
+    p += 12;
+  }
+  size_t size = DecodeScalar(in + i, n - i, p);
+  return size == kInvalid ? kInvalid : p - out + size;
+}
+
+__attribute__((target("avx2"))) size_t DecodeAvx2(const char* in, size_t n, char* out) {
+  const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  // pshufb 只在 128 位内移动, 两半各 12 个字节再拼到一起
+  const __m256i merge = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+  char* p  = out;
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i v     = _mm256_loadu_si256((const __m256i*) (in + i));
+    __m256i upper = InRange(v, 'A', 'Z');
+    __m256i lower = InRange(v, 'a', 'z');
+    __m256i digit = InRange(v, '0', '9');
+    __m256i plus  = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('+'));
+    __m256i slash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'));
+    __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                    _mm256_or_si256(_mm256_or_si256(digit, plus), slash));
+    if ((unsigned) _mm256_movemask_epi8(valid) != 0xffffffffu) {
+      return kInvalid;
+    }
+    __m256i shift = _mm256_or_si256(
+        _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-65)), _mm256_and_si256(lower, _mm256_set1_epi8(-71))),
+        _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(4)), _mm256_and_si256(plus, _mm256_set1_epi8(19))),
+            _mm256_and_si256(slash, _mm256_set1_epi8(16))));
+    v = _mm256_add_epi8(v, shift);
+
+    v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+    v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pack), merge);
+    _mm256_storeu_si256((__m256i*) p, v);
+    p += 24;
+  }
+  size_t size = DecodeSsse3(in + i, n - i, p);
+  return size == kInvalid ? kInvalid : p - out + size;
+}
+
+bool HaveSsse3() {
+  static const bool have = __builtin_cpu_supports("ssse3");
+  return have;
+}
+
+#endif  // FQ_HAVE_X86
+
+}  // namespace
+
+bool DecodeBase64(std::string_view in, std::string& out) {
+  return DecodeBase64(in, out, DetectSimdLevel());
+}
+
+bool DecodeBase64(std::string_view in, std::string& out, SimdLevel level) {
+  // 有填充时长度必须是 4 的倍数
+  size_t n = in.size();
+  if (n > 0 && in[n - 1] == '=') {
+    if (n % 4 != 0) {
+      out.clear();
+      return false;
+    }
+    n -= in[n - 2] == '=' ? 2 : 1;
+  }
+
+  out.resize(n / 4 * 3 + 2 + kSlack);
+  size_t size = kInvalid;
+#ifdef FQ_HAVE_X86
+  if (level >= kSimdAvx2 && DetectSimdLevel() >= kSimdAvx2) {
+    size = DecodeAvx2(in.data(), n, &out[0]);
+  } else if (level >= kSimdSse2 && HaveSsse3()) {
+    size = DecodeSsse3(in.data(), n, &out[0]);
+  } else {
+    size = DecodeScalar(in.data(), n, &out[0]);
+  }
+#else
+  size = DecodeScalar(in.data(), n, &out[0]);
+#endif
+  if (size == kInvalid) {
+    out.clear();
+    return false;
+  }
+  out.resize(size);
+  return true;
+}
+
+void EncodeBase64(std::string_view in, std::string& out) {
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t begin = out.size();
+  out.resize(begin + (in.size() + 2) / 3 * 4);
+  char* p  = &out[begin];
+  size_t i = 0;
+  for (; i + 3 <= in.size(); i += 3) {
+    uint32_t v = (uint32_t) (uint8_t) in[i] << 16 | (uint32_t) (uint8_t) in[i + 1] << 8 | (uint8_t) in[i + 2];
+    *p++ = kAlphabet[v >> 18];
+    *p++ = kAlphabet[v >> 12 & 63];
+    *p++ = kAlphabet[v >> 6 & 63];
+    *p++ = kAlphabet[v & 63];
+  }
+  if (i < in.size()) {
+    uint32_t v = (uint32_t) (uint8_t) in[i] << 16;
+    if (i + 1 < in.size()) {
+      v |= (uint32_t) (uint8_t) in[i + 1] << 8;
+    }
+    *p++ = kAlphabet[v >> 18];
+    *p++ = kAlphabet[v >> 12 & 63];
+    *p++ = i + 1 < in.size() ? kAlphabet[v >> 6 & 63] : '=';
+    *p++ = '=';
+  }
+}
+
+}  // namespace fq
@@ -0,0 +1,25 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.06
+
+#pragma once
+#include <string>
+#include <string_view>
+#include "literal_search.h"
+
+namespace fq {
+
+// 标准 base64 解码 (A-Z a-z 0-9 + /), 末尾最多两个 '=' 填充, 也接受没有填充的输入
+// 解码结果写入 out (覆盖原内容, 保留 out 的容量), 输入非法返回 false
+//   SSSE3: 每次 16 个字符解码为 12 个字节
+//   AVX2: 每次 32 个字符解码为 24 个字节
+bool DecodeBase64(std::string_view in, std::string& out);
+bool DecodeBase64(std::string_view in, std::string& out, SimdLevel level);
+
+// 标准 base64 编码, 带 '=' 填充, 追加到 out 末尾
+void EncodeBase64(std::string_view in, std::string& out);
+
+}  // namespace fq
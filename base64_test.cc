@@ -0,0 +1,83 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.06
+
+#include "base64.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace fq;
+
+static std::string Encode(std::string_view s) {
+  static const char kChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  size_t i = 0;
+  for (; i + 3 <= s.size(); i += 3) {
+    uint32_t v = (uint8_t) s[i] << 16 | (uint8_t) s[i + 1] << 8 | (uint8_t) s[i + 2];
+    out += {kChars[v >> 18], kChars[v >> 12 & 63], kChars[v >> 6 & 63], kChars[v & 63]};
+  }
+  if (i + 1 == s.size()) {
+    uint32_t v = (uint8_t) s[i] << 16;
+    out += {kChars[v >> 18], kChars[v >> 12 & 63], '=', '='};
+  } else if (i + 2 == s.size()) {
+    uint32_t v = (uint8_t) s[i] << 16 | (uint8_t) s[i + 1] << 8;
+    out += {kChars[v >> 18], kChars[v >> 12 & 63], kChars[v >> 6 & 63], '='};
+  }
+  return out;
+}
+
+TEST(Base64, Decode)
+{
+  std::string out;
+  for (auto level : {kSimdScalar, kSimdSse2, kSimdAvx2}) {
+    EXPECT_TRUE(DecodeBase64("", out, level));
+    EXPECT_EQ(out, "");
+    EXPECT_TRUE(DecodeBase64("MTh8Rg==", out, level));
+    EXPECT_EQ(out, "18|F");
+    EXPECT_TRUE(DecodeBase64("MTh8Rg", out, level));
+    EXPECT_EQ(out, "18|F");
+    EXPECT_TRUE(DecodeBase64("QWxpY2V8MTh8Rnx0aGUgcXVpY2sgYnJvd24gZm94IGp1bXBz", out, level));
+    EXPECT_EQ(out, "Alice|18|F|the quick brown fox jumps");
+
+    EXPECT_FALSE(DecodeBase64("MTh8Rg=", out, level));
+    EXPECT_FALSE(DecodeBase64("MTh8R", out, level));
+    EXPECT_FALSE(DecodeBase64("====", out, level));
+    EXPECT_FALSE(DecodeBase64("QWxpY2V8MTh8Rnx0aGUgcXVpY2sgYnJvd24gZm94IGp1bXB-", out, level));
+  }
+}
+
+TEST(Base64, HandleRandom)
+{
+  std::mt19937 rng(20220406);
+  std::string out;
+  for (int round = 0; round < 500; ++round) {
+    std::string s(rng() % 200, '\0');
+    for (auto& ch : s) {
+      ch = (char) rng();
+    }
+    std::string encoded = Encode(s);
+    // EncodeBase64 追加到已有内容之后
+    std::string appended = "x";
+    EncodeBase64(s, appended);
+    ASSERT_EQ(appended, "x" + encoded);
+    for (auto level : {kSimdScalar, kSimdSse2, kSimdAvx2}) {
+      ASSERT_TRUE(DecodeBase64(encoded, out, level)) << encoded;
+      ASSERT_EQ(out, s) << "level=" << level << " " << encoded;
+
+      // 任意位置放一个非法字符都应该失败
+      if (!encoded.empty()) {
+        std::string broken = encoded;
+        broken[rng() % (s.size() * 4 / 3)] = "-.\x80 "[rng() % 4];
+        ASSERT_FALSE(DecodeBase64(broken, out, level)) << "level=" << level << " " << broken;
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
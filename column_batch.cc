@@ -0,0 +1,260 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.16
+
+#include "column_batch.h"
+#include <array>
+#include <memory>
+#include "match_lines.h"
+
+namespace fq {
+
+namespace {
+
+void AppendBit(std::vector<uint8_t>& bits, int64_t row, bool value) {
+  if ((row & 7) == 0) {
+    bits.push_back(0);
+  }
+  bits.back() |= (uint8_t) value << (row & 7);
+}
+
+}  // namespace
+
+const char* Column::GetArrowFormat() const {
+  switch (type) {
+    case kFieldTypeInt:
+      return "l";
+    case kFieldTypeUint:
+    case kFieldTypeHex:
+      return "L";
+    case kFieldTypeFloat:
+      return "g";
+    case kFieldTypeBool:
+      return "b";
+    default:
+      // 匹配出的值不一定是合法的 UTF-8, 按 LargeBinary 导出
+      return "Z";
+  }
+}
+
+ColumnBatch::ColumnBatch(const CompiledFormat& format) {
+  const NameTable& names = format.GetNameTable();
+  columns_.resize(names.Size());
+  std::vector<uint8_t> typed(names.Size(), 0);
+  for (int slot = 0; slot < names.Size(); ++slot) {
+    columns_[slot].name = names.GetName(slot);
+  }
+  for (auto& field: format.GetFields()) {
+    Column& column = columns_[field.slot];
+    if (!typed[field.slot]) {
+      column.type       = field.field_type;
+      typed[field.slot] = 1;
+    } else if (column.type != field.field_type) {
+      column.type = kFieldTypeStr;
+    }
+  }
+}
+
+void ColumnBatch::Reserve(int64_t rows, size_t bytes_per_row) {
+  for (auto& column: columns_) {
+    column.validity.reserve((rows + 7) / 8);
+    switch (column.type) {
+      case kFieldTypeInt:
+        column.ints.reserve(rows);
+        break;
+      case kFieldTypeUint:
+      case kFieldTypeHex:
+        column.uints.reserve(rows);
+        break;
+      case kFieldTypeFloat:
+        column.floats.reserve(rows);
+        break;
+      case kFieldTypeBool:
+        column.bools.reserve((rows + 7) / 8);
+        break;
+      default:
+        column.offsets.reserve(rows + 1);
+        column.data.reserve(rows * bytes_per_row);
+        break;
+    }
+  }
+}
+
+void ColumnBatch::Append(bool matched, const MatchResult& result) {
+  for (int slot = 0; slot < (int) columns_.size(); ++slot) {
+    Column& column = columns_[slot];
+    const ResultItem* item = matched ? result.Get(slot) : nullptr;
+    // 列类型为 str 时字段可能是其他类型, 直接取原始文本
+    bool valid = item != nullptr && (column.type == kFieldTypeStr || item->typed_.type == column.type);
+    AppendBit(column.validity, rows_, valid);
+    if (!valid) {
+      ++column.null_count;
+    }
+    switch (column.type) {
+      case kFieldTypeInt:
+        column.ints.push_back(valid ? item->typed_.i : 0);
+        break;
+      case kFieldTypeUint:
+      case kFieldTypeHex:
+        column.uints.push_back(valid ? item->typed_.u : 0);
+        break;
+      case kFieldTypeFloat:
+        column.floats.push_back(valid ? item->typed_.f : 0);
+        break;
+      case kFieldTypeBool:
+        AppendBit(column.bools, rows_, valid && item->typed_.b);
+        break;
+      default:
+        if (valid) {
+          column.data.append(item->value_.data(), item->value_.size());
+        }
+        column.offsets.push_back((int64_t) column.data.size());
+        break;
+    }
+    ++column.length;
+  }
+  ++rows_;
+}
+
+void ColumnBatch::Clear() {
+  for (auto& column: columns_) {
+    column.length     = 0;
+    column.null_count = 0;
+    column.validity.clear();
+    column.offsets.resize(1);
+    column.data.clear();
+    column.ints.clear();
+    column.uints.clear();
+    column.floats.clear();
+    column.bools.clear();
+  }
+  rows_ = 0;
+}
+
+const Column* ColumnBatch::GetColumn(std::string_view name) const {
+  for (auto& column: columns_) {
+    if (column.name == name) {
+      return &column;
+    }
+  }
+  return nullptr;
+}
+
+size_t MatchColumns(const CompiledFormat& format, std::string_view buffer, ColumnBatch& batch) {
+  MatchResult result;
+  return MatchLines(format, buffer, result, [&](std::string_view, bool matched, const MatchResult& result) {
+    batch.Append(matched, result);
+  });
+}
+
+namespace {
+
+// schema 和 array 的根节点和每个子节点的 private_data 各持有一份 holder 的引用,
+// 子节点可以被使用方移走并晚于根节点释放
+struct SchemaHolder {
+  std::vector<std::string> names;
+  std::vector<ArrowSchema> children;
+  std::vector<ArrowSchema*> pointers;
+};
+
+struct ArrayHolder {
+  ColumnBatch batch;
+  std::vector<std::array<const void*, 3>> buffers;
+  std::vector<ArrowArray> children;
+  std::vector<ArrowArray*> pointers;
+  const void* root_buffers[1] = {nullptr};
+
+  explicit ArrayHolder(ColumnBatch&& b) : batch(std::move(b)) {}
+};
+
+template <class Holder, class T>
+void ReleaseChild(T* node) {
+  delete static_cast<std::shared_ptr<Holder>*>(node->private_data);
+  node->private_data = nullptr;
+  node->release      = nullptr;
+}
+
+// 先释放没有被移走的子节点
+template <class Holder, class T>
+void ReleaseRoot(T* node) {
+  auto holder = static_cast<std::shared_ptr<Holder>*>(node->private_data);
+  for (auto& child: (*holder)->children) {
+    if (child.release != nullptr) {
+      child.release(&child);
+    }
+  }
+  delete holder;
+  node->private_data = nullptr;
+  node->release      = nullptr;
+}
+
+// 空的缓冲区也不能是 nullptr
+const void* NonNull(const void* p) {
+  static const int64_t kEmpty = 0;
+  return p != nullptr ? p : &kEmpty;
+}
+
+}  // namespace
+
+int ExportArrow(ColumnBatch&& batch, ArrowSchema* schema, ArrowArray* array) {
+  if (schema == nullptr || array == nullptr) {
+    return -1;
+  }
+  auto schema_holder = std::make_shared<SchemaHolder>();
+  auto array_holder  = std::make_shared<ArrayHolder>(std::move(batch));
+  const ColumnBatch& b = array_holder->batch;
+  const int n          = b.GetColumnCount();
+
+  schema_holder->names.reserve(n);
+  schema_holder->children.resize(n);
+  array_holder->buffers.resize(n);
+  array_holder->children.resize(n);
+  for (int i = 0; i < n; ++i) {
+    const Column& column = b.GetColumn(i);
+    schema_holder->names.push_back(column.name);
+    schema_holder->children[i] = ArrowSchema{column.GetArrowFormat(), schema_holder->names[i].c_str(), nullptr,
+                                             ARROW_FLAG_NULLABLE, 0, nullptr, nullptr,
+                                             ReleaseChild<SchemaHolder, ArrowSchema>,
+                                             new std::shared_ptr<SchemaHolder>(schema_holder)};
+    schema_holder->pointers.push_back(&schema_holder->children[i]);
+
+    auto& buffers = array_holder->buffers[i];
+    int64_t count = 2;
+    buffers[0]    = column.null_count > 0 ? NonNull(column.validity.data()) : nullptr;
+    switch (column.type) {
+      case kFieldTypeInt:
+        buffers[1] = NonNull(column.ints.data());
+        break;
+      case kFieldTypeUint:
+      case kFieldTypeHex:
+        buffers[1] = NonNull(column.uints.data());
+        break;
+      case kFieldTypeFloat:
+        buffers[1] = NonNull(column.floats.data());
+        break;
+      case kFieldTypeBool:
+        buffers[1] = NonNull(column.bools.data());
+        break;
+      default:
+        buffers[1] = column.offsets.data();
+        buffers[2] = NonNull(column.data.data());
+        count      = 3;
+        break;
+    }
+    array_holder->children[i] = ArrowArray{column.length, column.null_count, 0, count, 0, buffers.data(),
+                                           nullptr, nullptr, ReleaseChild<ArrayHolder, ArrowArray>,
+                                           new std::shared_ptr<ArrayHolder>(array_holder)};
+    array_holder->pointers.push_back(&array_holder->children[i]);
+  }
+
+  *schema = ArrowSchema{"+s", "", nullptr, 0, n, schema_holder->pointers.data(), nullptr,
+                        ReleaseRoot<SchemaHolder, ArrowSchema>, new std::shared_ptr<SchemaHolder>(schema_holder)};
+  *array  = ArrowArray{b.Size(), 0, 0, 1, n, array_holder->root_buffers, array_holder->pointers.data(), nullptr,
+                       ReleaseRoot<ArrayHolder, ArrowArray>, new std::shared_ptr<ArrayHolder>(array_holder)};
+  return 0;
+}
+
+}  // namespace fq
@@ -0,0 +1,118 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.16
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "compiled_format.h"
+
+// Arrow C data interface, 定义与 https://arrow.apache.org/docs/format/CDataInterface.html 一致
+// 已经包含了 arrow 的头文件时使用 arrow 的定义
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+  void (*release)(struct ArrowSchema*);
+  void* private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+  void (*release)(struct ArrowArray*);
+  void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+namespace fq {
+
+// 一个字段的所有行, 内存布局与 Arrow 相同
+//   validity: 第 i 位为 1 表示第 i 行有值, 低位在前, 行没有匹配或字段没有设置时为 0
+//   str: LargeBinary, offsets 有 Size() + 1 个, 第 i 行为 data[offsets[i], offsets[i + 1])
+//   int: int64, uint/hex: uint64, float: double, bool: 按位保存
+// 值为 null 的行在值数组中占位 0, 在 offsets 中长度为 0
+struct Column {
+  std::string name;
+  FieldType type = kFieldTypeStr;
+  int64_t length     = 0;
+  int64_t null_count = 0;
+
+  std::vector<uint8_t> validity;
+  std::vector<int64_t> offsets = {0};
+  std::string data;
+  std::vector<int64_t> ints;
+  std::vector<uint64_t> uints;
+  std::vector<double> floats;
+  std::vector<uint8_t> bools;
+
+  bool IsValid(int64_t row) const { return validity[row >> 3] >> (row & 7) & 1; }
+  std::string_view GetString(int64_t row) const {
+    return std::string_view(data).substr(offsets[row], offsets[row + 1] - offsets[row]);
+  }
+  bool GetBool(int64_t row) const { return bools[row >> 3] >> (row & 7) & 1; }
+
+  // Arrow 的类型描述, 如 "l", "Z"
+  const char* GetArrowFormat() const;
+};
+
+// 按列保存多行匹配结果, 每个 slot 一列
+// 每一行只追加到各列的末尾, 不为每一行创建 MatchResult 或 map
+class ColumnBatch {
+ public:
+  // 列类型取字段的类型, 同名字段类型不一致时为 str
+  explicit ColumnBatch(const CompiledFormat& format);
+
+  // 预留 rows 行, str 列按每行 bytes_per_row 字节预留
+  void Reserve(int64_t rows, size_t bytes_per_row = 0);
+
+  // 追加一行, matched 为 false 时所有列都是 null
+  // str 列会拷贝 value, 之后 result 指向的数据可以释放
+  void Append(bool matched, const MatchResult& result);
+
+  // 清空所有行, 保留内存
+  void Clear();
+
+  int64_t Size() const { return rows_; }
+  int GetColumnCount() const { return (int) columns_.size(); }
+  const Column& GetColumn(int slot) const { return columns_[slot]; }
+  // 找不到返回 nullptr
+  const Column* GetColumn(std::string_view name) const;
+
+ private:
+  std::vector<Column> columns_;
+  int64_t rows_ = 0;
+};
+
+// 按行匹配 buffer 并把结果追加到 batch, 规则同 MatchLines, 返回匹配成功的行数
+size_t MatchColumns(const CompiledFormat& format, std::string_view buffer, ColumnBatch& batch);
+
+// 把 batch 导出为 Arrow 的 struct 数组, 每列一个子数组, 数据不拷贝
+// batch 被移动到导出的 array 中, 由 array->release 释放; schema 独立于 array, 各自 release
+// 返回 0 成功
+int ExportArrow(ColumnBatch&& batch, ArrowSchema* schema, ArrowArray* array);
+
+}  // namespace fq
@@ -0,0 +1,138 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.16
+
+#include "column_batch.h"
+#include <gtest/gtest.h>
+
+using namespace fq;
+
+TEST(ColumnBatch, MatchColumns)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}|{score:float}|{vip:bool}", compiled), 0);
+
+  ColumnBatch batch(compiled);
+  ASSERT_EQ(batch.GetColumnCount(), 4);
+  batch.Reserve(4, 8);
+  std::string buffer = "Alice|18|9.5|true\nbad line\nBob|x|1|0\r\n|20|0.25|1";
+  EXPECT_EQ(MatchColumns(compiled, buffer, batch), 2u);
+  ASSERT_EQ(batch.Size(), 4);
+
+  const Column& name = *batch.GetColumn("name");
+  EXPECT_EQ(std::string(name.GetArrowFormat()), "Z");
+  EXPECT_EQ(name.null_count, 2);
+  EXPECT_EQ(name.offsets, (std::vector<int64_t>{0, 5, 5, 5, 5}));
+  EXPECT_EQ(name.GetString(0), "Alice");
+  EXPECT_TRUE(name.IsValid(3));
+  EXPECT_EQ(name.GetString(3), "");
+  EXPECT_FALSE(name.IsValid(1));
+  EXPECT_FALSE(name.IsValid(2));
+
+  const Column& age = *batch.GetColumn("age");
+  EXPECT_EQ(std::string(age.GetArrowFormat()), "l");
+  EXPECT_EQ(age.ints, (std::vector<int64_t>{18, 0, 0, 20}));
+  EXPECT_EQ(age.validity, (std::vector<uint8_t>{0x9}));
+
+  const Column& score = *batch.GetColumn("score");
+  EXPECT_EQ(score.floats, (std::vector<double>{9.5, 0, 0, 0.25}));
+
+  const Column& vip = *batch.GetColumn("vip");
+  EXPECT_EQ(std::string(vip.GetArrowFormat()), "b");
+  EXPECT_TRUE(vip.GetBool(0));
+  EXPECT_TRUE(vip.GetBool(3));
+  EXPECT_FALSE(vip.GetBool(1));
+  EXPECT_EQ(batch.GetColumn("nope"), nullptr);
+
+  batch.Clear();
+  EXPECT_EQ(batch.Size(), 0);
+  EXPECT_EQ(batch.GetColumn(0).offsets.size(), 1u);
+}
+
+TEST(ColumnBatch, MixedTypeIsStr)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{id:int}|{Raw({id}-{x})}", compiled), 0);
+  ColumnBatch batch(compiled);
+  ASSERT_EQ(batch.GetColumnCount(), 2);
+  EXPECT_EQ(batch.GetColumn("id")->type, kFieldTypeStr);
+}
+
+TEST(ColumnBatch, ExportArrow)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", compiled), 0);
+  ColumnBatch batch(compiled);
+  MatchColumns(compiled, "Alice|18\nx\nBob|20", batch);
+
+  ArrowSchema schema;
+  ArrowArray array;
+  ASSERT_EQ(ExportArrow(std::move(batch), &schema, &array), 0);
+
+  EXPECT_EQ(std::string(schema.format), "+s");
+  ASSERT_EQ(schema.n_children, 2);
+  EXPECT_EQ(std::string(schema.children[0]->name), "name");
+  EXPECT_EQ(std::string(schema.children[0]->format), "Z");
+  EXPECT_EQ(std::string(schema.children[1]->format), "l");
+
+  EXPECT_EQ(array.length, 3);
+  ASSERT_EQ(array.n_children, 2);
+  const ArrowArray* name = array.children[0];
+  EXPECT_EQ(name->n_buffers, 3);
+  EXPECT_EQ(name->null_count, 1);
+  auto validity = static_cast<const uint8_t*>(name->buffers[0]);
+  auto offsets  = static_cast<const int64_t*>(name->buffers[1]);
+  auto data     = static_cast<const char*>(name->buffers[2]);
+  EXPECT_EQ(validity[0] & 0x7, 0x5);
+  EXPECT_EQ(std::string(data + offsets[2], offsets[3] - offsets[2]), "Bob");
+
+  const ArrowArray* age = array.children[1];
+  EXPECT_EQ(age->n_buffers, 2);
+  EXPECT_EQ(static_cast<const int64_t*>(age->buffers[1])[2], 20);
+
+  schema.release(&schema);
+  array.release(&array);
+  EXPECT_EQ(schema.release, nullptr);
+  EXPECT_EQ(array.release, nullptr);
+}
+
+TEST(ColumnBatch, ExportArrowMoveChild)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", compiled), 0);
+  ColumnBatch batch(compiled);
+  MatchColumns(compiled, "Alice|18\nBob|20", batch);
+
+  ArrowSchema schema;
+  ArrowArray array;
+  ASSERT_EQ(ExportArrow(std::move(batch), &schema, &array), 0);
+
+  // 使用方按 C data interface 移走子节点, 之后先释放根节点
+  ArrowArray name             = *array.children[0];
+  array.children[0]->release  = nullptr;
+  ArrowSchema name_schema     = *schema.children[0];
+  schema.children[0]->release = nullptr;
+  array.release(&array);
+  schema.release(&schema);
+
+  EXPECT_EQ(std::string(name_schema.name), "name");
+  auto offsets = static_cast<const int64_t*>(name.buffers[1]);
+  auto data    = static_cast<const char*>(name.buffers[2]);
+  EXPECT_EQ(std::string(data + offsets[1], offsets[2] - offsets[1]), "Bob");
+  name.release(&name);
+  name_schema.release(&name_schema);
+  EXPECT_EQ(name.release, nullptr);
+  EXPECT_EQ(name_schema.release, nullptr);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,431 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.22
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include "matcher.h"
+
+// 编译期解析 format
+//
+//   auto format = FQ_COMPILE("{name:str}|{age:int}");
+//   decltype(format)::Fields fields;
+//   format.Match("Alice|18", fields);
+//
+// 规则与 Tokenizer/FormatParser 一致, 暂不支持 decl
+// 每个文本和字段都在编译期展开, 匹配时没有虚函数调用也不需要解析
+// 查找文本使用与运行期相同的 LiteralSearcher
+#define FQ_COMPILE(s)                                              \
+  ::fq::MakeStaticFormat([] {                                      \
+    struct FqCompileString {                                       \
+      static constexpr std::string_view value() { return s; }     \
+    };                                                             \
+    return FqCompileString();                                      \
+  }())
+
+namespace fq {
+namespace detail {
+
+enum CtElementKind {
+  kCtLiteral = 1,
+  kCtField   = 2,
+};
+
+// 编译期的 element, 文本都以 [begin, begin+size) 的形式指向 format
+struct CtElement {
+  int kind          = 0;
+  size_t begin      = 0;  // 文本或字段名
+  size_t size       = 0;
+  size_t type_begin = 0;
+  size_t type_size  = 0;
+  size_t spec_begin = 0;
+  size_t spec_size  = 0;
+};
+
+template <size_t N>
+struct CtFormat {
+  CtElement elements[N] = {};
+  size_t count          = 0;
+  int error             = 0;
+};
+
+// 与 Tokenizer::GetNextMatchToken 使用的 ID 字符集一致
+constexpr bool IsCtIdChar(char ch) {
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' ||
+         ch == '<' || ch == '>' || ch == '+' || ch == '-';
+}
+
+constexpr bool IsCtWhite(char ch) { return ch == ' ' || ch == '\t' || ch == '\n'; }
+
+// element 个数的上限: 每个 '{' 最多带来一个字段和一个文本
+constexpr size_t CtCapacity(std::string_view s) {
+  size_t n = 1;
+  for (char ch : s) {
+    if (ch == '{') {
+      n += 2;
+    }
+  }
+  return n;
+}
+
+template <size_t N>
+constexpr CtFormat<N> ParseCt(std::string_view s) {
+  CtFormat<N> f{};
+  size_t pos = 0;
+  while (pos < s.size()) {
+    size_t begin = pos;
+    while (pos < s.size() && s[pos] != '{' && s[pos] != '}') {
+      pos += (s[pos] == '\\') ? 2 : 1;
+    }
+    if (pos > s.size()) {
+      pos = s.size();
+    }
+    if (pos > begin) {
+      CtElement e{};
+      e.kind                  = kCtLiteral;
+      e.begin                 = begin;
+      e.size                  = pos - begin;
+      f.elements[f.count++]   = e;
+    }
+    if (pos >= s.size()) {
+      break;
+    }
+    if (s[pos] == '}') {
+      f.error = -2;
+      return f;
+    }
+
+    // {name:type:spec}
+    ++pos;
+    CtElement e{};
+    e.kind = kCtField;
+    while (true) {
+      while (pos < s.size() && IsCtWhite(s[pos])) {
+        ++pos;
+      }
+      size_t id_begin = pos;
+      while (pos < s.size() && IsCtIdChar(s[pos])) {
+        ++pos;
+      }
+      size_t id_size = pos - id_begin;
+      // 与 Tokenizer 一样, 每个 token 之前都跳过空白
+      while (pos < s.size() && IsCtWhite(s[pos])) {
+        ++pos;
+      }
+      if (pos >= s.size()) {
+        f.error = -4;
+        return f;
+      }
+      char ch = s[pos++];
+      if (ch == '(') {
+        // decl 只能在运行期解析
+        f.error = -11;
+        return f;
+      }
+      if ((ch != ':' && ch != '}') || id_size == 0) {
+        f.error = -3;
+        return f;
+      }
+      if (e.size == 0) {
+        e.begin = id_begin;
+        e.size  = id_size;
+      } else if (e.type_size == 0 && id_size > 2) {
+        e.type_begin = id_begin;
+        e.type_size  = id_size;
+      } else if (e.spec_size == 0 && id_size == 2) {
+        e.spec_begin = id_begin;
+        e.spec_size  = id_size;
+      } else {
+        f.error = -3;
+        return f;
+      }
+      if (ch == '}') {
+        break;
+      }
+    }
+    f.elements[f.count++] = e;
+  }
+  return f;
+}
+
+template <size_t N>
+constexpr size_t CtFieldCount(const CtFormat<N>& f) {
+  size_t n = 0;
+  for (size_t i = 0; i < f.count; ++i) {
+    if (f.elements[i].kind == kCtField) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+// 第 i 个 element 之前的字段数, 即该字段的下标
+template <size_t N>
+constexpr size_t CtFieldIndex(const CtFormat<N>& f, size_t i) {
+  size_t n = 0;
+  for (size_t k = 0; k < i; ++k) {
+    if (f.elements[k].kind == kCtField) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+// 每个字段的 slot: 同名字段共用一个, 按名字第一次出现的顺序编号, 与 NameTable::Intern 一致
+template <size_t M, size_t N>
+constexpr std::array<int, M> CtSlots(std::string_view pattern, const CtFormat<N>& f) {
+  std::array<std::string_view, M> names{};
+  std::array<int, M> slots{};
+  size_t n  = 0;
+  int count = 0;
+  for (size_t i = 0; i < f.count; ++i) {
+    if (f.elements[i].kind != kCtField) {
+      continue;
+    }
+    names[n] = pattern.substr(f.elements[i].begin, f.elements[i].size);
+    slots[n] = -1;
+    for (size_t k = 0; k < n; ++k) {
+      if (names[k] == names[n]) {
+        slots[n] = slots[k];
+        break;
+      }
+    }
+    if (slots[n] < 0) {
+      slots[n] = count++;
+    }
+    ++n;
+  }
+  return slots;
+}
+
+template <size_t M>
+constexpr size_t CtNameCount(const std::array<int, M>& slots) {
+  size_t n = 0;
+  for (size_t i = 0; i < M; ++i) {
+    if ((size_t) slots[i] + 1 > n) {
+      n = slots[i] + 1;
+    }
+  }
+  return n;
+}
+
+struct CtState {
+  size_t pos = 0;
+};
+
+}  // namespace detail
+
+// 编译期特化的匹配器, 语义与 FormatRootNode::Handle 一致
+template <class S>
+class StaticFormat {
+ public:
+  static constexpr std::string_view kPattern = S::value();
+  static constexpr size_t kCapacity           = detail::CtCapacity(kPattern);
+  static constexpr detail::CtFormat<kCapacity> kFormat = detail::ParseCt<kCapacity>(kPattern);
+  static_assert(kFormat.error == 0, "fq: invalid format string");
+  static constexpr size_t kFieldCount = detail::CtFieldCount(kFormat);
+  // 字段下标 -> slot, 与同一个 format 编译出的 CompiledFormat 相同
+  static constexpr std::array<int, kFieldCount> kSlots = detail::CtSlots<kFieldCount>(kPattern, kFormat);
+  static constexpr size_t kNameCount                   = detail::CtNameCount(kSlots);
+
+  // 按 format 中出现的顺序保存字段
+  using Fields = std::array<std::string_view, kFieldCount>;
+  using Values = std::array<FieldValue, kFieldCount>;
+
+  static constexpr std::string_view FieldName(size_t index) {
+    return kPattern.substr(FieldElement(index).begin, FieldElement(index).size);
+  }
+  static constexpr std::string_view FieldTypeName(size_t index) {
+    return kPattern.substr(FieldElement(index).type_begin, FieldElement(index).type_size);
+  }
+
+  // 类型不匹配时失败, 转换后的值保存在 values
+  static bool Match(std::string_view s, Fields& fields, Values& values) {
+    detail::CtState state;
+    if (!Run(s, state, fields, std::make_index_sequence<kFormat.count>())) {
+      return false;
+    }
+    return Convert(fields, values, std::make_index_sequence<kFieldCount>());
+  }
+
+  static bool Match(std::string_view s, Fields& fields) {
+    Values values;
+    return Match(s, fields, values);
+  }
+
+  // 按 slot 的名字表, 第一次调用时创建
+  static const NameTable& GetNameTable() {
+    static const NameTable names = [] {
+      NameTable table;
+      for (size_t i = 0; i < kFieldCount; ++i) {
+        table.Intern(FieldName(i));
+      }
+      return table;
+    }();
+    return names;
+  }
+
+  // 同名字段写入同一个 slot, 后出现的覆盖先出现的
+  static bool Match(std::string_view s, MatchResult& result) {
+    Fields fields;
+    Values values;
+    result.Reset(&GetNameTable());
+    if (!Match(s, fields, values)) {
+      return false;
+    }
+    for (size_t i = 0; i < kFieldCount; ++i) {
+      result.Set(kSlots[i], FieldName(i), FieldTypeName(i), fields[i], values[i]);
+    }
+    return true;
+  }
+
+ private:
+  static constexpr const detail::CtElement& FieldElement(size_t index) {
+    size_t n = 0;
+    for (size_t i = 0; i < kFormat.count; ++i) {
+      if (kFormat.elements[i].kind == detail::kCtField) {
+        if (n == index) {
+          return kFormat.elements[i];
+        }
+        ++n;
+      }
+    }
+    return kFormat.elements[0];
+  }
+
+  template <size_t... I>
+  static bool Run(std::string_view s, detail::CtState& state, Fields& fields, std::index_sequence<I...>) {
+    return (Step<I>(s, state, fields) && ...) && Finish(s, state, fields);
+  }
+
+  template <size_t... I>
+  static bool Convert(const Fields& fields, Values& values, std::index_sequence<I...>) {
+    return (ConvertOne<I>(fields[I], values[I]) && ...);
+  }
+
+  template <size_t I>
+  static bool ConvertOne(std::string_view text, FieldValue& value) {
+    constexpr auto type = ParseFieldType(FieldTypeName(I));
+    if constexpr (type == kFieldTypeStr) {
+      return true;
+    } else {
+      return ConvertField(type, text, value);
+    }
+  }
+
+  // 定宽字段的宽度, 不是定宽返回 0
+  static constexpr int Width(const detail::CtElement& e) {
+    return ParseFieldWidth(kPattern.substr(e.spec_begin, e.spec_size));
+  }
+
+  // 第 I 个 element 之前连续的定宽字段从哪个 element 开始, 没有则为 I
+  template <size_t I>
+  static constexpr size_t RunBegin() {
+    size_t i = I;
+    while (i > 0 && kFormat.elements[i - 1].kind == detail::kCtField && Width(kFormat.elements[i - 1]) > 0) {
+      --i;
+    }
+    return i;
+  }
+
+  // [RunBegin<I>(), I) 的总宽度
+  template <size_t I>
+  static constexpr size_t RunWidth() {
+    size_t width = 0;
+    for (size_t i = RunBegin<I>(); i < I; ++i) {
+      width += Width(kFormat.elements[i]);
+    }
+    return width;
+  }
+
+  // 前面有还没有确定结束位置的字段, 它和第 I 个 element 之间只有定宽字段
+  template <size_t I>
+  static constexpr bool PrevIsPending() {
+    constexpr size_t begin = RunBegin<I>();
+    return begin > 0 && kFormat.elements[begin - 1].kind == detail::kCtField && Width(kFormat.elements[begin - 1]) == 0;
+  }
+
+  // [B, E) 都是定宽字段, 从 pos 开始依次切分
+  template <size_t B, size_t E>
+  static void TakeFixedRun(std::string_view s, size_t pos, Fields& fields) {
+    if constexpr (B < E) {
+      constexpr detail::CtElement e = kFormat.elements[B];
+      constexpr auto type           = ParseFieldType(kPattern.substr(e.type_begin, e.type_size));
+      fields[detail::CtFieldIndex(kFormat, B)] = TrimFixedField(type, s.substr(pos, Width(e)));
+      TakeFixedRun<B + 1, E>(s, pos + Width(e), fields);
+    }
+  }
+
+  // 待处理字段和之后的定宽字段分 [state.pos, end), 定宽字段占末尾
+  template <size_t I>
+  static bool Split(std::string_view s, size_t end, detail::CtState& state, Fields& fields) {
+    constexpr size_t begin = RunBegin<I>();
+    constexpr size_t width = RunWidth<I>();
+    if (end - state.pos < width) {
+      return false;
+    }
+    fields[detail::CtFieldIndex(kFormat, begin - 1)] = s.substr(state.pos, end - width - state.pos);
+    TakeFixedRun<begin, I>(s, end - width, fields);
+    return true;
+  }
+
+  template <size_t I>
+  static bool Step(std::string_view s, detail::CtState& state, Fields& fields) {
+    constexpr detail::CtElement e = kFormat.elements[I];
+    if constexpr (e.kind == detail::kCtLiteral) {
+      constexpr std::string_view literal = kPattern.substr(e.begin, e.size);
+      if constexpr (PrevIsPending<I>()) {
+        // 查找策略只在第一次调用时确定
+        static const LiteralSearcher searcher(literal);
+        size_t found = searcher.Find(s, state.pos);
+        if (found == LiteralSearcher::npos || !Split<I>(s, found, state, fields)) {
+          return false;
+        }
+        state.pos = found + literal.size();
+      } else {
+        if (s.size() - state.pos < literal.size() || s.compare(state.pos, literal.size(), literal) != 0) {
+          return false;
+        }
+        state.pos += literal.size();
+      }
+      return true;
+    } else if constexpr (Width(e) > 0 && PrevIsPending<I>()) {
+      // 跟在待处理字段之后, 由下一个文本或 Finish 从后往前切分
+      return true;
+    } else if constexpr (Width(e) > 0) {
+      constexpr size_t width = Width(e);
+      if (s.size() - state.pos < width) {
+        return false;
+      }
+      constexpr auto type = ParseFieldType(kPattern.substr(e.type_begin, e.type_size));
+      fields[detail::CtFieldIndex(kFormat, I)] = TrimFixedField(type, s.substr(state.pos, width));
+      state.pos += width;
+      return true;
+    } else if constexpr (PrevIsPending<I>()) {
+      // 两个字段相邻, 无法切分
+      return false;
+    } else {
+      return true;
+    }
+  }
+
+  static bool Finish(std::string_view s, detail::CtState& state, Fields& fields) {
+    if constexpr (PrevIsPending<kFormat.count>()) {
+      return Split<kFormat.count>(s, s.size(), state, fields);
+    }
+    return true;
+  }
+};
+
+template <class S>
+constexpr StaticFormat<S> MakeStaticFormat(S) {
+  return StaticFormat<S>();
+}
+
+}  // namespace fq
@@ -0,0 +1,670 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.20
+
+#include "compiled_format.h"
+#include <cinttypes>
+#include <cstring>
+
+// 每条指令的计数, 与 FQ_STAT_* 一样只在定义了 FQ_ENABLE_STATS 时生效
+// FQ_NODE_BEGIN 取本线程的计数, 之后的 FQ_NODE_ADD 只写本线程的计数
+#ifdef FQ_ENABLE_STATS
+#define FQ_NODE_BEGIN() \
+  std::atomic<uint64_t>* node_stats = ::fq::LocalNodeStats(stats_id_, program_.size() * ::fq::kStatNodeCount)
+#define FQ_NODE_ADD(pc, counter, n) ::fq::StatAdd(node_stats[(pc) * ::fq::kStatNodeCount + (counter)], (n))
+#else
+#define FQ_NODE_BEGIN() ((void) 0)
+#define FQ_NODE_ADD(pc, counter, n) ((void) 0)
+#endif
+#define FQ_NODE_FAIL(pc, reason)                           \
+  do {                                                     \
+    FQ_STAT_FAIL(reason);                                  \
+    FQ_NODE_ADD(pc, ::fq::kStatNodeFailure + (reason), 1); \
+  } while (0)
+
+namespace fq {
+
+namespace {
+
+// 节点在 format 文本中的位置: 字段名或 decl 名
+int SourcePos(const FormatAstNode* node) {
+  auto matcher = dynamic_cast<const FormatMatcherNode*>(node);
+  if (matcher == nullptr) {
+    return -1;
+  }
+  const Token& token = matcher->GetDecl() ? matcher->GetDecl()->GetName() : matcher->GetName();
+  return token.IsEmpty() ? -1 : token.GetPos();
+}
+
+}  // namespace
+
+int FormatParser::Parse(const std::string& str, CompiledFormat& compiled) {
+  FormatRootNode root;
+  int ret = Parse(str, root);
+  if (ret != 0) {
+    return ret;
+  }
+  return compiled.Compile(root);
+}
+
+int CompiledFormat::Compile(const FormatRootNode& root) {
+  // 上次编译的结果全部丢弃, 包括 Analyze 计算的部分
+  *this = CompiledFormat();
+  int ret = CompileRoot(root, 0);
+  if (ret != 0) {
+    // 编译失败的 format 不匹配任何行
+    *this = CompiledFormat();
+    Emit(kOpFail);
+  } else {
+    Emit(kOpMatch);
+  }
+  Analyze();
+  if (kStatsEnabled) {
+    stats_id_ = NewStatId();
+  }
+  return ret;
+}
+
+void CompiledFormat::Analyze() {
+  summary_ = FormatSummary();
+
+  // 开头连续的 AnchorLiteral 组成前缀
+  size_t anchored = 0;
+  for (auto& ins: program_) {
+    if (ins.op != kOpAnchorLiteral) {
+      break;
+    }
+    summary_.prefix += literals_[ins.arg].GetLiteral();
+    ++anchored;
+  }
+
+  // 只有 AnchorLiteral 和定宽字段时, 所有偏移在编译时就可以确定
+  fixed_layout_ = true;
+  fixed_size_   = 0;
+  fixed_items_.clear();
+  int width = 0;
+  for (size_t pc = 0; pc < program_.size(); ++pc) {
+    auto& ins = program_[pc];
+    if (ins.op == kOpAnchorLiteral) {
+      int size = (int) literals_[ins.arg].Size();
+      fixed_items_.push_back(FixedItem{true, ins.arg, fixed_size_, size, (int) pc});
+      fixed_size_ += size;
+    } else if (ins.op == kOpTakeFixed) {
+      width = ins.arg;
+    } else if (ins.op == kOpCapture) {
+      fixed_items_.push_back(FixedItem{false, ins.arg, fixed_size_, width, (int) pc});
+    } else if (ins.op == kOpAdvance) {
+      fixed_size_ += width;
+      width = 0;
+    } else if (ins.op != kOpMatch) {
+      fixed_layout_ = false;
+      fixed_items_.clear();
+      break;
+    }
+  }
+
+  // Raw 只是收缩窗口, 其中的文本也一定出现在行中
+  // Raw 的窗口可能来自定宽字段, 最小长度只统计最外层
+  std::vector<int> decls;
+  int not_raw = 0;
+  int rarest  = 256;
+  for (size_t i = 0; i < program_.size(); ++i) {
+    auto& ins = program_[i];
+    if (ins.op == kOpEnterDecl) {
+      decls.push_back(ins.arg);
+      not_raw += ins.arg != kDeclRaw;
+    } else if (ins.op == kOpLeaveDecl) {
+      not_raw -= decls.back() != kDeclRaw;
+      decls.pop_back();
+    } else if (ins.op == kOpTakeFixed && decls.empty()) {
+      summary_.min_length += ins.arg;
+    } else if ((ins.op == kOpAnchorLiteral || ins.op == kOpFindLiteral) && not_raw == 0) {
+      const std::string& literal = literals_[ins.arg].GetLiteral();
+      summary_.required_literals.push_back(ins.arg);
+      if (decls.empty()) {
+        summary_.min_length += (int) literal.size();
+      }
+      if (i < anchored) {
+        continue;
+      }
+      for (unsigned char ch: literal) {
+        if (ByteFrequency(ch) < rarest) {
+          rarest             = ByteFrequency(ch);
+          summary_.rare_byte = ch;
+        }
+      }
+    }
+  }
+}
+
+// 与 FormatRootNode::Handle 的语义保持一致:
+// 前面没有待处理字段的文本必须出现在当前位置, 否则查找文本, 文本之前的内容交给待处理字段
+int CompiledFormat::CompileRoot(const FormatRootNode& root, int depth) {
+  if (depth > kMaxDeclDepth) {
+    return -20;
+  }
+  const FormatAstNode* pending = nullptr;
+  // 紧跟在 pending 之后的定宽字段
+  std::vector<const FormatAstNode*> fixed;
+  int fixed_width = 0;
+  for (auto& element: root.GetElements()) {
+    if (element->IsLiteral()) {
+      auto literal = static_cast<const FormatLiteralNode*>(element.get());
+      literals_.emplace_back(literal->GetToken().GetString());
+      int index = (int) literals_.size() - 1;
+      int pos   = literal->GetToken().GetPos();
+      if (pending) {
+        Emit(kOpFindLiteral, index, pos);
+        int ret = CompileSplit(pending, fixed, fixed_width, depth);
+        if (ret != 0) {
+          return ret;
+        }
+        pending = nullptr;
+      } else {
+        Emit(kOpAnchorLiteral, index, pos);
+      }
+    } else {
+      int width = element->GetWidth();
+      if (pending) {
+        if (width == 0) {
+          // 两个字段相邻, 无法切分
+          Emit(kOpFail, 0, SourcePos(element.get()));
+          return 0;
+        }
+        fixed.push_back(element.get());
+        fixed_width += width;
+      } else if (width > 0) {
+        Emit(kOpTakeFixed, width, SourcePos(element.get()));
+        int ret = CompilePending(element.get(), depth);
+        if (ret != 0) {
+          return ret;
+        }
+        Emit(kOpAdvance);
+      } else {
+        pending = element.get();
+        fixed.clear();
+        fixed_width = 0;
+      }
+    }
+  }
+  if (pending) {
+    Emit(kOpTakeRest, 0, SourcePos(pending));
+    return CompileSplit(pending, fixed, fixed_width, depth);
+  }
+  return 0;
+}
+
+// region 已经由 FindLiteral/TakeRest 确定, 末尾 fixed_width 个字节依次分给 fixed, 其余给 pending
+int CompiledFormat::CompileSplit(const FormatAstNode* pending, const std::vector<const FormatAstNode*>& fixed,
+                                 int fixed_width, int depth) {
+  if (fixed.empty()) {
+    int ret = CompilePending(pending, depth);
+    if (ret != 0) {
+      return ret;
+    }
+    Emit(kOpAdvance);
+    return 0;
+  }
+  Emit(kOpBackOff, fixed_width, SourcePos(pending));
+  int ret = CompilePending(pending, depth);
+  if (ret != 0) {
+    return ret;
+  }
+  Emit(kOpAdvance);
+  for (auto element: fixed) {
+    Emit(kOpTakeFixed, element->GetWidth(), SourcePos(element));
+    ret = CompilePending(element, depth);
+    if (ret != 0) {
+      return ret;
+    }
+    Emit(kOpAdvance);
+  }
+  Emit(kOpResume);
+  return 0;
+}
+
+int CompiledFormat::CompilePending(const FormatAstNode* pending, int depth) {
+  auto matcher = dynamic_cast<const FormatMatcherNode*>(pending);
+  int pos      = SourcePos(pending);
+  if (matcher == nullptr) {
+    Emit(kOpFail, 0, pos);
+    return 0;
+  }
+  auto& decl = matcher->GetDecl();
+  if (!decl) {
+    if (matcher->GetName().IsEmpty()) {
+      Emit(kOpFail, 0, pos);
+      return 0;
+    }
+    auto name = matcher->GetName().GetString();
+    fields_.push_back(FieldInfo{std::string(name), std::string(matcher->GetType().GetString()), matcher->GetFieldType(),
+                                names_.Intern(name), matcher->GetWidth()});
+    Emit(kOpCapture, (int) fields_.size() - 1, pos);
+    return 0;
+  }
+
+  if (decl->GetName().IsEmpty()) {
+    Emit(kOpFail, 0, pos);
+    return 0;
+  }
+  auto func_name = decl->GetName().GetString();
+  if (func_name == "Raw" || func_name == "Base64") {
+    if (decl->GetParams().size() != 1) {
+      Emit(kOpFail, 0, pos);
+      return 0;
+    }
+    Emit(kOpEnterDecl, func_name == "Raw" ? kDeclRaw : kDeclBase64, pos);
+    int ret = CompileRoot(*decl->GetParams().at(0), depth + 1);
+    if (ret != 0) {
+      return ret;
+    }
+    Emit(kOpLeaveDecl);
+    return 0;
+  }
+  if (func_name == "FKV") {
+    auto& keys = decl->GetFkvFields();
+    if (keys.empty()) {
+      Emit(kOpFail, 0, pos);
+      return 0;
+    }
+    FkvInfo fkv{decl->GetPairSep(), decl->GetKvSep(), decl->GetFkvIndex(), {}};
+    for (auto key: keys) {
+      auto name = key->GetName().GetString();
+      fields_.push_back(FieldInfo{std::string(name), std::string(key->GetType().GetString()), key->GetFieldType(),
+                                  names_.Intern(name), key->GetWidth()});
+      fkv.fields.push_back((int) fields_.size() - 1);
+    }
+    fkvs_.push_back(std::move(fkv));
+    Emit(kOpFkv, (int) fkvs_.size() - 1, pos);
+    return 0;
+  }
+  Emit(kOpFail, 0, pos);
+  return 0;
+}
+
+int CompiledFormat::Project(const std::vector<std::string>& names, bool validate, Projection& projection) const {
+  projection.validate = validate;
+  projection.wanted.assign(fields_.size(), 0);
+  projection.skip.assign(program_.size(), -1);
+  projection.last = -1;
+  for (auto& name: names) {
+    int slot = names_.Find(name);
+    if (slot < 0) {
+      return -1;
+    }
+    // 同名字段共用 slot, 都需要
+    for (size_t i = 0; i < fields_.size(); ++i) {
+      if (fields_[i].slot == slot) {
+        projection.wanted[i] = 1;
+      }
+    }
+  }
+  if (validate) {
+    return 0;
+  }
+
+  // 从后往前, 记录每个 decl 之后是否有需要的字段
+  std::vector<int> leaves;
+  std::vector<bool> inner_wanted;
+  bool wanted = false;
+  for (int pc = (int) program_.size() - 1; pc >= 0; --pc) {
+    auto& ins = program_[pc];
+    bool here = false;
+    if (ins.op == kOpCapture) {
+      here = projection.wanted[ins.arg] != 0;
+    } else if (ins.op == kOpFkv) {
+      for (int field: fkvs_[ins.arg].fields) {
+        here = here || projection.wanted[field] != 0;
+      }
+      if (!here) {
+        projection.skip[pc] = pc + 1;
+      }
+    } else if (ins.op == kOpLeaveDecl) {
+      leaves.push_back(pc);
+      inner_wanted.push_back(false);
+    } else if (ins.op == kOpEnterDecl) {
+      if (!inner_wanted.back()) {
+        projection.skip[pc] = leaves.back() + 1;
+      }
+      bool inner = inner_wanted.back();
+      leaves.pop_back();
+      inner_wanted.pop_back();
+      if (!inner_wanted.empty()) {
+        inner_wanted.back() = inner_wanted.back() || inner;
+      }
+    }
+    if (here) {
+      if (!wanted) {
+        projection.last = pc;
+        wanted          = true;
+      }
+      if (!inner_wanted.empty()) {
+        inner_wanted.back() = true;
+      }
+    }
+  }
+  return 0;
+}
+
+bool CompiledFormat::Match(std::string_view s, MatchResult& result) const {
+  bool ok;
+  if (fixed_layout_) {
+    ok = MatchFixed(s, result);
+  } else if (!summary_.MayMatch(s)) {
+    result.Reset(&names_);
+    FQ_STAT_FAIL(kStatPrefilter);
+    ok = false;
+  } else {
+    ok = MatchImpl<false>(s, nullptr, result);
+  }
+  FQ_STAT_ADD(kStatMatches, 1);
+  FQ_STAT_ADD(kStatMatched, ok);
+  return ok;
+}
+
+bool CompiledFormat::MatchFixed(std::string_view s, MatchResult& result) const {
+  result.Reset(&names_);
+  FQ_NODE_BEGIN();
+  if ((int) s.size() < fixed_size_) {
+    // 记在第一个超出行尾的文本或字段上
+    for (auto& item: fixed_items_) {
+      if (item.offset + item.width > (int) s.size()) {
+        FQ_NODE_FAIL(item.pc, kStatPastStop);
+        break;
+      }
+    }
+    return false;
+  }
+  for (auto& item: fixed_items_) {
+    FQ_NODE_ADD(item.pc, kStatNodeCalls, 1);
+    if (item.literal) {
+      if (memcmp(s.data() + item.offset, literals_[item.index].GetLiteral().data(), item.width) != 0) {
+        FQ_NODE_FAIL(item.pc, kStatNotAnchored);
+        return false;
+      }
+      continue;
+    }
+    const FieldInfo& field = fields_[item.index];
+    auto value = TrimFixedField(field.field_type, s.substr(item.offset, item.width));
+    FieldValue typed;
+    if (!ConvertField(field.field_type, value, typed)) {
+      FQ_NODE_FAIL(item.pc, kStatConvert);
+      return false;
+    }
+    result.Set(field.slot, field.name, field.type, value, typed);
+  }
+  return true;
+}
+
+bool CompiledFormat::Match(std::string_view s, const Projection& projection, MatchResult& result) const {
+  // 不 validate 时取到需要的字段就返回, 之后的文本不一定会被检查
+  bool ok;
+  if (projection.validate && !summary_.MayMatch(s)) {
+    result.Reset(&names_);
+    FQ_STAT_FAIL(kStatPrefilter);
+    ok = false;
+  } else {
+    ok = MatchImpl<true>(s, &projection, result);
+  }
+  FQ_STAT_ADD(kStatMatches, 1);
+  FQ_STAT_ADD(kStatMatched, ok);
+  return ok;
+}
+
+template <bool kProject>
+bool CompiledFormat::MatchImpl(std::string_view s, const Projection* projection, MatchResult& result) const {
+  struct Frame {
+    int stop;
+    int next;
+    int mark;
+    std::string_view s;
+    // 统计 decl 耗时
+    int kind;
+    int pc;
+    uint64_t start;
+  };
+  Frame frames[kMaxDeclDepth + 1];
+  int depth = 0;
+  result.Reset(&names_);
+  FQ_NODE_BEGIN();
+
+  int pos = 0;
+  int stop = (int) s.size();
+  int region_begin = 0, region_end = 0, next = 0, mark = 0;
+
+  for (const Instruction* ins = program_.data();; ++ins) {
+    FQ_STAT_ADD(kStatOp + ins->op, 1);
+    FQ_NODE_ADD(ins - program_.data(), kStatNodeCalls, 1);
+    switch (ins->op) {
+      case kOpAnchorLiteral: {
+        const std::string& literal = literals_[ins->arg].GetLiteral();
+        int size = (int) literal.size();
+        if (stop - pos < size) {
+          FQ_NODE_FAIL(ins - program_.data(), kStatPastStop);
+          return false;
+        }
+        if (s.compare(pos, size, literal) != 0) {
+          FQ_NODE_FAIL(ins - program_.data(), kStatNotAnchored);
+          return false;
+        }
+        pos += size;
+        break;
+      }
+      case kOpFindLiteral: {
+        const LiteralSearcher& literal = literals_[ins->arg];
+        auto found = literal.Find(s.substr(0, stop), pos);
+        if (found == LiteralSearcher::npos) {
+          FQ_STAT_ADD(kStatLiteralBytes, stop - pos);
+          FQ_NODE_ADD(ins - program_.data(), kStatNodeScanned, stop - pos);
+          FQ_NODE_FAIL(ins - program_.data(), kStatLiteralNotFound);
+          return false;
+        }
+        FQ_STAT_ADD(kStatLiteralBytes, found + literal.Size() - pos);
+        FQ_NODE_ADD(ins - program_.data(), kStatNodeScanned, found + literal.Size() - pos);
+        region_begin = pos;
+        region_end   = (int) found;
+        next         = (int) (found + literal.Size());
+        break;
+      }
+      case kOpTakeRest:
+        region_begin = pos;
+        region_end   = stop;
+        next         = stop;
+        break;
+      case kOpTakeFixed:
+        if (stop - pos < ins->arg) {
+          FQ_NODE_FAIL(ins - program_.data(), kStatPastStop);
+          return false;
+        }
+        region_begin = pos;
+        region_end   = pos + ins->arg;
+        next         = region_end;
+        break;
+      case kOpBackOff:
+        if (region_end - region_begin < ins->arg) {
+          FQ_NODE_FAIL(ins - program_.data(), kStatPastStop);
+          return false;
+        }
+        mark        = next;
+        region_end -= ins->arg;
+        next        = region_end;
+        break;
+      case kOpResume:
+        pos = mark;
+        break;
+      case kOpCapture: {
+        const FieldInfo& field = fields_[ins->arg];
+        if (kProject && !projection->wanted[ins->arg] && !projection->validate) {
+          break;
+        }
+        auto value = s.substr(region_begin, region_end - region_begin);
+        if (field.width > 0) {
+          value = TrimFixedField(field.field_type, value);
+        }
+        FieldValue typed;
+        if (!ConvertField(field.field_type, value, typed)) {
+          FQ_NODE_FAIL(ins - program_.data(), kStatConvert);
+          return false;
+        }
+        if (kProject && !projection->wanted[ins->arg]) {
+          break;
+        }
+        result.Set(field.slot, field.name, field.type, value, typed);
+        if (kProject && ins - program_.data() == projection->last) {
+          return true;
+        }
+        break;
+      }
+      case kOpEnterDecl:
+        if (kProject && projection->skip[ins - program_.data()] >= 0) {
+          // 跳过整个 decl, 外层的 stop/next 没有变化, 下一条是 kOpAdvance
+          ins = program_.data() + projection->skip[ins - program_.data()] - 1;
+          break;
+        }
+        frames[depth++] = Frame{stop, next, mark, s, ins->arg == kDeclBase64 ? kStatDeclBase64 : kStatDeclRaw,
+                                (int) (ins - program_.data()), FQ_STAT_NOW()};
+        if (ins->arg == kDeclBase64) {
+          // 解码结果放在 result 中, 字段的 value 可以直接指向它
+          std::string& decoded = result.AcquireScratch();
+          if (!DecodeBase64(s.substr(region_begin, region_end - region_begin), decoded)) {
+            FQ_NODE_FAIL(ins - program_.data(), kStatDeclFailed);
+            return false;
+          }
+          s    = decoded;
+          pos  = 0;
+          stop = (int) decoded.size();
+        } else {
+          pos  = region_begin;
+          stop = region_end;
+        }
+        break;
+      case kOpLeaveDecl:
+        --depth;
+        FQ_STAT_DECL(frames[depth].kind, frames[depth].start);
+        FQ_NODE_ADD(frames[depth].pc, kStatNodeNanos, FQ_STAT_NOW() - frames[depth].start);
+        stop = frames[depth].stop;
+        next = frames[depth].next;
+        mark = frames[depth].mark;
+        s    = frames[depth].s;
+        break;
+      case kOpAdvance:
+        pos = next;
+        break;
+      case kOpFkv: {
+        if (kProject && projection->skip[ins - program_.data()] >= 0) {
+          break;
+        }
+        const FkvInfo& fkv = fkvs_[ins->arg];
+        auto region = s.substr(region_begin, region_end - region_begin);
+        [[maybe_unused]] uint64_t start = FQ_STAT_NOW();
+        bool found = ScanFkv(region, fkv.pair_sep, fkv.kv_sep, fkv.index, [&](int key, std::string_view value) {
+          const FieldInfo& field = fields_[fkv.fields[key]];
+          // 与 FormatMatcherNode::Handle 一致, 定宽的 key 只去掉两边的空格
+          if (field.width > 0) {
+            value = TrimFixedField(field.field_type, value);
+          }
+          FieldValue typed;
+          if (!ConvertField(field.field_type, value, typed)) {
+            return false;
+          }
+          if (kProject && !projection->wanted[fkv.fields[key]]) {
+            return true;
+          }
+          return result.Set(field.slot, field.name, field.type, value, typed);
+        });
+        FQ_STAT_DECL(kStatDeclFkv, start);
+        FQ_NODE_ADD(ins - program_.data(), kStatNodeNanos, FQ_STAT_NOW() - start);
+        if (!found) {
+          FQ_NODE_FAIL(ins - program_.data(), kStatDeclFailed);
+          return false;
+        }
+        if (kProject && ins - program_.data() == projection->last) {
+          return true;
+        }
+        break;
+      }
+      case kOpFail:
+        FQ_NODE_FAIL(ins - program_.data(), kStatAdjacent);
+        return false;
+      case kOpMatch:
+        return true;
+    }
+  }
+}
+
+const char* GetOpName(int op) {
+  static const char* names[] = {"", "AnchorLiteral", "FindLiteral", "TakeRest", "Capture",
+                                "EnterDecl", "LeaveDecl", "Advance", "Fail", "Match", "Fkv", "TakeFixed",
+                                "BackOff", "Resume"};
+  if (op < 0 || op >= (int) (sizeof(names) / sizeof(names[0]))) {
+    return "Unknown";
+  }
+  return names[op];
+}
+
+void CompiledFormat::Dump() const {
+  for (size_t i = 0; i < program_.size(); ++i) {
+    auto& ins = program_[i];
+    printf("%3d %s", (int) i, GetOpName(ins.op));
+    if (ins.op == kOpAnchorLiteral || ins.op == kOpFindLiteral) {
+      printf(" '%s'", literals_[ins.arg].GetLiteral().c_str());
+    } else if (ins.op == kOpCapture) {
+      printf(" %s:%s", fields_[ins.arg].name.c_str(), fields_[ins.arg].type.c_str());
+    } else if (ins.op == kOpEnterDecl || ins.op == kOpTakeFixed || ins.op == kOpBackOff) {
+      printf(" %d", ins.arg);
+    } else if (ins.op == kOpFkv) {
+      for (int field: fkvs_[ins.arg].fields) {
+        printf(" %s:%s", fields_[field].name.c_str(), fields_[field].type.c_str());
+      }
+    }
+    printf("\n");
+  }
+}
+
+uint64_t CompiledFormat::GetNodeStat(int pc, int counter) const {
+  if (stats_id_ == 0) {
+    return 0;
+  }
+  return GetNodeStats(stats_id_, program_.size() * kStatNodeCount)[pc * kStatNodeCount + counter];
+}
+
+void CompiledFormat::PrintStats(FILE* out, std::string_view text) const {
+  if (stats_id_ == 0) {
+    fprintf(out, "stats are disabled, rebuild with -DFQ_ENABLE_STATS\n");
+    return;
+  }
+  std::vector<uint64_t> stats = GetNodeStats(stats_id_, program_.size() * kStatNodeCount);
+  fprintf(out, "format: %.*s\n", (int) text.size(), text.data());
+  fprintf(out, "%4s %-13s %-22s %10s %12s %10s %s\n", "pc", "op", "source", "calls", "scanned", "ns/call",
+          "failures");
+  for (int pc = 0; pc < (int) program_.size(); ++pc) {
+    const uint64_t* node = stats.data() + pc * kStatNodeCount;
+    bool touched = false;
+    for (int counter = 0; counter < kStatNodeCount; ++counter) {
+      touched = touched || node[counter] > 0;
+    }
+    if (!touched) {
+      continue;
+    }
+    // 指令位置开始的一段 format 文本
+    std::string source;
+    int pos = positions_[pc];
+    if (pos >= 0 && pos < (int) text.size()) {
+      source = "@" + std::to_string(pos) + " " + std::string(text.substr(pos, 14));
+    }
+    uint64_t calls = node[kStatNodeCalls];
+    fprintf(out, "%4d %-13s %-22s %10" PRIu64 " %12" PRIu64 " %10.1f", pc, GetOpName(program_[pc].op),
+            source.c_str(), calls, node[kStatNodeScanned], calls > 0 ? (double) node[kStatNodeNanos] / calls : 0.0);
+    for (int reason = 0; reason < kStatFailureCount; ++reason) {
+      if (node[kStatNodeFailure + reason] > 0) {
+        fprintf(out, " %s=%" PRIu64, GetStatFailureName(reason), node[kStatNodeFailure + reason]);
+      }
+    }
+    fprintf(out, "\n");
+  }
+}
+
+}  // namespace fq
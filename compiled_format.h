@@ -0,0 +1,195 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.20
+
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "literal_search.h"
+#include "matcher.h"
+
+namespace fq {
+
+// 指令类型
+// 解释器维护几个寄存器: pos 当前位置, stop 当前窗口结尾,
+// [region_begin, region_end) 待处理区间, next 处理完待处理区间之后的位置, mark 见 kOpBackOff
+enum OpCode {
+  kOpAnchorLiteral = 1,  // 文本必须出现在 pos, pos 跳过文本
+  kOpFindLiteral   = 2,  // 在 [pos, stop) 中查找文本, region = [pos, 文本开头), next = 文本结尾
+  kOpTakeRest      = 3,  // region = [pos, stop), next = stop
+  kOpCapture       = 4,  // 保存 region 到字段 arg
+  kOpEnterDecl     = 5,  // 进入 decl arg, 窗口收缩到 region, Base64 则切换到 region 解码后的数据
+  kOpLeaveDecl     = 6,  // 离开 decl, 恢复外层窗口
+  kOpAdvance       = 7,  // pos = next
+  kOpFail          = 8,  // 格式本身无法匹配
+  kOpMatch         = 9,  // 匹配成功
+  kOpFkv           = 10, // 在 region 中查找 FKV arg 需要的 key, 保存到对应字段
+  kOpTakeFixed     = 11, // region = [pos, pos + arg), next = pos + arg, 超出 stop 失败
+  kOpBackOff       = 12, // region 末尾 arg 个字节留给之后的定宽字段: mark = next, region_end -= arg, next = region_end
+  kOpResume        = 13, // pos = mark, 跳过 BackOff 留下的定宽字段和之后的文本
+};
+static_assert(kOpResume < kStatOpCount, "fq: too many opcodes for match stats");
+
+// 指令名, 用于 Dump 和统计
+const char* GetOpName(int op);
+
+// decl 类型
+enum DeclKind {
+  kDeclRaw    = 1,
+  kDeclBase64 = 2,
+};
+
+struct Instruction {
+  OpCode op;
+  int arg;  // 文本/字段/decl 下标, 与 op 相关
+};
+
+struct FieldInfo {
+  std::string name;
+  std::string type;
+  FieldType field_type;
+  int slot;
+  // 定宽字段的宽度, 0 表示不定宽
+  int width = 0;
+};
+
+struct FkvInfo {
+  LiteralSearcher pair_sep;
+  LiteralSearcher kv_sep;
+  FkvIndex index;
+  // key 下标 -> fields_ 下标
+  std::vector<int> fields;
+};
+
+// 只需要部分字段时的匹配方式, 由 CompiledFormat::Project 创建, 只能用于创建它的 format
+//   validate 为 true: 仍然完整地检查整行(包括不需要字段的类型), 只是不写入不需要的字段
+//   validate 为 false: 跳过不包含需要字段的 decl, 不转换不需要的字段, 最后一个需要的字段取到后立即返回成功
+struct Projection {
+  bool validate = true;
+  // fields_ 下标 -> 是否需要
+  std::vector<uint8_t> wanted;
+  // 指令下标 -> 可以直接跳到的指令下标, -1 表示不跳过
+  std::vector<int> skip;
+  // 执行完这条指令后返回成功, -1 表示执行到 kOpMatch
+  int last = -1;
+};
+
+// 整行的必要条件, 由 CompiledFormat 在编译时计算, 完整匹配之前先用它排除不可能匹配的行
+// 只统计行上直接出现的内容, Base64 解码后的文本不参与
+// 最后一个文本之后可以有任意内容, 所以没有固定的后缀
+struct FormatSummary {
+  // 行上所有文本和定宽字段的长度之和
+  int min_length = 0;
+  // 开头连续的 AnchorLiteral
+  std::string prefix;
+  // 行中一定出现的文本, 为 literals_ 的下标
+  std::vector<int> required_literals;
+  // prefix 之后一定出现的字节, 取自必需文本中最少见的字节, -1 表示没有
+  int rare_byte = -1;
+
+  // 返回 false 时一定不匹配
+  bool MayMatch(std::string_view s) const {
+    if ((int) s.size() < min_length || s.compare(0, prefix.size(), prefix) != 0) {
+      return false;
+    }
+    return rare_byte < 0 || memchr(s.data() + prefix.size(), rare_byte, s.size() - prefix.size()) != nullptr;
+  }
+};
+
+// 把 FormatRootNode 树降级为连续的指令数组, 用非递归的解释器执行
+// 编译后不再引用语法树, 只读, 可以被多个线程共享
+class CompiledFormat {
+ public:
+  CompiledFormat() = default;
+
+  int Compile(const FormatRootNode& root);
+
+  // result 会先被 Reset 并绑定到本 format 的名字表
+  bool Match(std::string_view s, MatchResult& result) const;
+  // 只取 projection 中的字段, 其他 slot 在 result 中无效
+  bool Match(std::string_view s, const Projection& projection, MatchResult& result) const;
+
+  // names 中有不存在的字段时返回 -1
+  int Project(const std::vector<std::string>& names, bool validate, Projection& projection) const;
+
+  const std::vector<Instruction>& GetProgram() const { return program_; }
+  const std::vector<LiteralSearcher>& GetLiterals() const { return literals_; }
+  const std::vector<FieldInfo>& GetFields() const { return fields_; }
+  const std::vector<FkvInfo>& GetFkvs() const { return fkvs_; }
+  const NameTable& GetNameTable() const { return names_; }
+  // 找不到返回 -1
+  int GetSlot(std::string_view name) const { return names_.Find(name); }
+
+  // 全部由定宽字段和文本组成, 匹配时只做偏移计算
+  bool IsFixedLayout() const { return fixed_layout_; }
+
+  // Match 之前用于排除的条件
+  const FormatSummary& GetSummary() const { return summary_; }
+  // 匹配成功的行必须以 prefix 开头
+  const std::string& GetPrefix() const { return summary_.prefix; }
+  // 匹配成功的行中一定出现的文本, 为 literals_ 的下标
+  const std::vector<int>& GetRequiredLiterals() const { return summary_.required_literals; }
+
+  void Dump() const;
+
+  // 指令对应的 format 文本位置, 没有时为 -1
+  int GetSourcePos(int pc) const { return positions_[pc]; }
+  // 指令 pc 在所有线程中的计数, counter 为 StatNodeCounter; 没有定义 FQ_ENABLE_STATS 时总是 0
+  // 拷贝的 format 与原来的共用计数, 重新 Compile 后从 0 开始
+  uint64_t GetNodeStat(int pc, int counter) const;
+  // 逐条打印执行过的指令的计数, text 为编译时的 format 文本, 用于标出指令对应的位置
+  void PrintStats(FILE* out, std::string_view text) const;
+
+  // 嵌套 decl 的最大深度
+  static constexpr int kMaxDeclDepth = 32;
+
+ private:
+  int CompileRoot(const FormatRootNode& root, int depth);
+  int CompilePending(const FormatAstNode* pending, int depth);
+  int CompileSplit(const FormatAstNode* pending, const std::vector<const FormatAstNode*>& fixed, int fixed_width,
+                   int depth);
+  void Emit(OpCode op, int arg = 0, int pos = -1) {
+    program_.push_back(Instruction{op, arg});
+    positions_.push_back(pos);
+  }
+  void Analyze();
+  template <bool kProject>
+  bool MatchImpl(std::string_view s, const Projection* projection, MatchResult& result) const;
+  bool MatchFixed(std::string_view s, MatchResult& result) const;
+
+ private:
+  std::vector<Instruction> program_;
+  // 与 program_ 一一对应
+  std::vector<int> positions_;
+  // 查找策略在编译时确定
+  std::vector<LiteralSearcher> literals_;
+  std::vector<FieldInfo> fields_;
+  std::vector<FkvInfo> fkvs_;
+  NameTable names_;
+
+  // 由 Analyze() 计算, 用于预先过滤
+  FormatSummary summary_;
+
+  // 定宽布局: 每个文本和字段在行中的偏移都是固定的
+  struct FixedItem {
+    bool literal;
+    int index;  // literals_ 或 fields_ 下标
+    int offset;
+    int width;
+    int pc;  // 对应的指令, 用于统计
+  };
+  bool fixed_layout_ = false;
+  int fixed_size_    = 0;
+  std::vector<FixedItem> fixed_items_;
+
+  // 指令计数在 match_stats 中的 id, 0 表示没有统计
+  uint64_t stats_id_ = 0;
+};
+
+}  // namespace fq
@@ -0,0 +1,122 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.26
+
+#include "field_type.h"
+#include <charconv>
+#include <cstring>
+
+namespace fq {
+
+namespace {
+
+// 8 个字节是否都是 '0'-'9'
+inline bool IsEightDigits(uint64_t chunk) {
+  return (((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+           (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL);
+}
+
+// 小端序下把 8 个数字转换为整数, 只需要三次乘法
+inline uint32_t ParseEightDigits(uint64_t chunk) {
+  chunk -= 0x3030303030303030ULL;
+  chunk = (chunk * 10) + (chunk >> 8);
+  chunk = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+           (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+  return (uint32_t) chunk;
+}
+
+template <class T>
+bool FromChars(std::string_view text, T& value, int base = 10) {
+  auto end = text.data() + text.size();
+  auto ret = std::from_chars(text.data(), end, value, base);
+  return ret.ec == std::errc() && ret.ptr == end;
+}
+
+bool FromChars(std::string_view text, double& value) {
+  auto end = text.data() + text.size();
+  auto ret = std::from_chars(text.data(), end, value);
+  return ret.ec == std::errc() && ret.ptr == end;
+}
+
+}  // namespace
+
+bool ParseUint64(std::string_view text, uint64_t& value) {
+  // 19 位以内不会溢出, 更长的交给 from_chars 检查
+  if (text.empty() || text.size() > 19) {
+    return FromChars(text, value);
+  }
+  const char* p = text.data();
+  size_t n      = text.size();
+  uint64_t v    = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (n >= 8) {
+    uint64_t chunk;
+    memcpy(&chunk, p, 8);
+    if (!IsEightDigits(chunk)) {
+      return false;
+    }
+    v = v * 100000000ULL + ParseEightDigits(chunk);
+    p += 8;
+    n -= 8;
+  }
+#endif
+  for (; n > 0; --n, ++p) {
+    unsigned digit = (unsigned char) *p - '0';
+    if (digit > 9) {
+      return false;
+    }
+    v = v * 10 + digit;
+  }
+  value = v;
+  return true;
+}
+
+bool ParseInt64(std::string_view text, int64_t& value) {
+  bool negative = !text.empty() && text[0] == '-';
+  auto digits   = negative ? text.substr(1) : text;
+  // 18 位以内不会溢出
+  if (digits.empty() || digits.size() > 18) {
+    return FromChars(text, value);
+  }
+  uint64_t v;
+  if (!ParseUint64(digits, v)) {
+    return false;
+  }
+  value = negative ? -(int64_t) v : (int64_t) v;
+  return true;
+}
+
+bool ConvertField(FieldType type, std::string_view text, FieldValue& value) {
+  value.type = type;
+  switch (type) {
+    case kFieldTypeStr:
+      return true;
+    case kFieldTypeInt:
+      return ParseInt64(text, value.i);
+    case kFieldTypeUint:
+      return ParseUint64(text, value.u);
+    case kFieldTypeFloat:
+      return !text.empty() && FromChars(text, value.f);
+    case kFieldTypeHex:
+      if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text.remove_prefix(2);
+      }
+      return !text.empty() && FromChars(text, value.u, 16);
+    case kFieldTypeBool:
+      if (text == "true" || text == "1") {
+        value.b = true;
+        return true;
+      }
+      if (text == "false" || text == "0") {
+        value.b = false;
+        return true;
+      }
+      return false;
+  }
+  return false;
+}
+
+}  // namespace fq
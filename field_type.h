@@ -0,0 +1,86 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.26
+
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace fq {
+
+// 字段类型, 由 {name:type} 中的 type 决定
+enum FieldType {
+  kFieldTypeStr   = 0,  // 默认, 不认识的类型也按字符串处理
+  kFieldTypeInt   = 1,  // int64_t, 可以带 '-'
+  kFieldTypeUint  = 2,  // uint64_t
+  kFieldTypeFloat = 3,  // double
+  kFieldTypeHex   = 4,  // uint64_t, 可以带 0x 前缀
+  kFieldTypeBool  = 5,  // true/false/1/0
+};
+
+constexpr FieldType ParseFieldType(std::string_view type) {
+  if (type == "int") {
+    return kFieldTypeInt;
+  }
+  if (type == "uint") {
+    return kFieldTypeUint;
+  }
+  if (type == "float") {
+    return kFieldTypeFloat;
+  }
+  if (type == "hex") {
+    return kFieldTypeHex;
+  }
+  if (type == "bool") {
+    return kFieldTypeBool;
+  }
+  return kFieldTypeStr;
+}
+
+// {name:type:spec} 中 spec 为两位数字时表示定宽字段, 如 {id:int:08} 恰好占 8 个字节
+// 不是定宽返回 0
+constexpr int ParseFieldWidth(std::string_view spec) {
+  if (spec.size() != 2 || spec[0] < '0' || spec[0] > '9' || spec[1] < '0' || spec[1] > '9') {
+    return 0;
+  }
+  return (spec[0] - '0') * 10 + (spec[1] - '0');
+}
+
+// 定宽的数值字段通常用空格补齐, 转换前去掉两边的空格; 字符串保持原样
+constexpr std::string_view TrimFixedField(FieldType type, std::string_view value) {
+  if (type == kFieldTypeStr) {
+    return value;
+  }
+  while (!value.empty() && value.front() == ' ') {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && value.back() == ' ') {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+// 转换后的值, 字符串类型只保留原始文本
+struct FieldValue {
+  FieldType type = kFieldTypeStr;
+  union {
+    int64_t i;
+    uint64_t u;
+    double f;
+    bool b;
+  };
+
+  FieldValue() : u(0) {}
+};
+
+// 把 text 转换为 type 类型, 格式不对返回 false
+bool ConvertField(FieldType type, std::string_view text, FieldValue& value);
+
+// 十进制无符号整数, 8 个数字一组转换
+bool ParseUint64(std::string_view text, uint64_t& value);
+bool ParseInt64(std::string_view text, int64_t& value);
+
+}  // namespace fq
@@ -0,0 +1,45 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.08
+
+#include "fkv.h"
+
+namespace fq {
+
+int FkvIndex::Add(std::string_view key) {
+  if ((int) keys_.size() >= kMaxKeys) {
+    return -1;
+  }
+  for (auto& exist: keys_) {
+    if (exist == key) {
+      return -1;
+    }
+  }
+  keys_.emplace_back(key);
+  return (int) keys_.size() - 1;
+}
+
+void FkvIndex::Build() {
+  size_t size = 4;
+  while (size < keys_.size() * 2) {
+    size *= 2;
+  }
+  table_.assign(size, -1);
+  lengths_ = 0;
+  for (int index = 0; index < (int) keys_.size(); ++index) {
+    auto& key = keys_[index];
+    if (key.size() < 64) {
+      lengths_ |= 1ull << key.size();
+    }
+    size_t i = Hash(key) & (size - 1);
+    while (table_[i] >= 0) {
+      i = (i + 1) & (size - 1);
+    }
+    table_[i] = index;
+  }
+}
+
+}  // namespace fq
@@ -0,0 +1,102 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.08
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "literal_search.h"
+
+namespace fq {
+
+// FKV 需要的 key, 解析 format 时构建, 之后只读
+// 开放寻址的哈希表, 查找前先按长度过滤, 大部分不需要的 key 不用计算哈希
+class FkvIndex {
+ public:
+  // uint64_t 的位图记录已找到的 key
+  static constexpr int kMaxKeys = 64;
+
+  FkvIndex() = default;
+
+  // 返回 key 的下标, key 重复或超过 kMaxKeys 返回 -1
+  int Add(std::string_view key);
+  void Build();
+
+  // 找不到返回 -1
+  int Find(std::string_view key) const {
+    if (key.size() < 64 && (lengths_ >> key.size() & 1) == 0) {
+      return -1;
+    }
+    if (table_.empty()) {
+      return -1;
+    }
+    for (size_t i = Hash(key) & (table_.size() - 1);; i = (i + 1) & (table_.size() - 1)) {
+      int index = table_[i];
+      if (index < 0 || keys_[index] == key) {
+        return index;
+      }
+    }
+  }
+
+  int Size() const { return (int) keys_.size(); }
+  const std::string& GetKey(int index) const { return keys_[index]; }
+
+ private:
+  // FNV-1a
+  static uint64_t Hash(std::string_view key) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char ch : key) {
+      h = (h ^ ch) * 1099511628211ull;
+    }
+    return h;
+  }
+
+ private:
+  std::vector<std::string> keys_;
+  // 长度为 2 的幂, 至少一半是空位, -1 表示空
+  std::vector<int> table_;
+  // 第 n 位表示有长度为 n 的 key, 长度 >= 64 的 key 不过滤
+  uint64_t lengths_ = 0;
+};
+
+// 按 pair_sep 切分 s, 每一对再按第一个 kv_sep 切分为 key 和 value
+// 对 index 中的 key 调用 found(key 下标, value), 同一个 key 只取第一次出现, 没有 kv_sep 的一对被忽略
+// 所有 key 都找到后立即返回 true, 不再扫描剩余部分; 扫描完仍有 key 没找到, 或 found 返回 false, 返回 false
+template <class Callback>
+bool ScanFkv(std::string_view s, const LiteralSearcher& pair_sep, const LiteralSearcher& kv_sep,
+             const FkvIndex& index, Callback&& found) {
+  const uint64_t all = index.Size() == 64 ? ~0ull : (1ull << index.Size()) - 1;
+  uint64_t seen = 0;
+  if (all == 0) {
+    return true;
+  }
+  size_t pos = 0;
+  while (true) {
+    size_t end = pair_sep.Find(s, pos);
+    std::string_view pair = s.substr(pos, end == LiteralSearcher::npos ? std::string_view::npos : end - pos);
+    size_t kv = kv_sep.Find(pair);
+    if (kv != LiteralSearcher::npos) {
+      int key = index.Find(pair.substr(0, kv));
+      if (key >= 0 && (seen >> key & 1) == 0) {
+        if (!found(key, pair.substr(kv + kv_sep.Size()))) {
+          return false;
+        }
+        seen |= 1ull << key;
+        if (seen == all) {
+          return true;
+        }
+      }
+    }
+    if (end == LiteralSearcher::npos) {
+      return false;
+    }
+    pos = end + pair_sep.Size();
+  }
+}
+
+}  // namespace fq
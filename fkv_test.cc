@@ -0,0 +1,68 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.08
+
+#include "fkv.h"
+#include <gtest/gtest.h>
+
+using namespace fq;
+
+TEST(FkvIndex, Find)
+{
+  FkvIndex index;
+  for (int i = 0; i < FkvIndex::kMaxKeys; ++i) {
+    EXPECT_EQ(index.Add("key" + std::to_string(i)), i);
+  }
+  EXPECT_EQ(index.Add("overflow"), -1);
+  index.Build();
+
+  for (int i = 0; i < FkvIndex::kMaxKeys; ++i) {
+    EXPECT_EQ(index.Find("key" + std::to_string(i)), i);
+  }
+  EXPECT_EQ(index.Find(""), -1);
+  EXPECT_EQ(index.Find("key"), -1);
+  EXPECT_EQ(index.Find("key64"), -1);
+  EXPECT_EQ(index.Find(std::string(100, 'k')), -1);
+
+  FkvIndex dup;
+  EXPECT_EQ(dup.Add("a"), 0);
+  EXPECT_EQ(dup.Add("a"), -1);
+}
+
+TEST(FkvIndex, Scan)
+{
+  FkvIndex index;
+  index.Add("b");
+  index.Add(std::string(70, 'x'));
+  index.Build();
+  LiteralSearcher pair_sep("&"), kv_sep("=");
+
+  std::vector<std::pair<int, std::string>> found;
+  auto collect = [&](int key, std::string_view value) {
+    found.emplace_back(key, value);
+    return true;
+  };
+  std::string long_key(70, 'x');
+  EXPECT_TRUE(ScanFkv("a=1&" + long_key + "=2&b=3&b=4", pair_sep, kv_sep, index, collect));
+  ASSERT_EQ(found.size(), 2u);
+  EXPECT_EQ(found[1], std::make_pair(0, std::string("3")));
+
+  // 找齐之后不再扫描
+  found.clear();
+  EXPECT_TRUE(ScanFkv("b=1=2&" + long_key + "=&rest", pair_sep, kv_sep, index, collect));
+  EXPECT_EQ(found[0], std::make_pair(0, std::string("1=2")));
+  EXPECT_EQ(found[1], std::make_pair(1, std::string("")));
+
+  found.clear();
+  EXPECT_FALSE(ScanFkv("b=1&c=2", pair_sep, kv_sep, index, collect));
+  EXPECT_FALSE(ScanFkv("", pair_sep, kv_sep, index, collect));
+  EXPECT_FALSE(ScanFkv("b=1&" + long_key + "=2", pair_sep, kv_sep, index, [](int, std::string_view) { return false; }));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.11
+
+#include "format_cache.h"
+
+namespace fq {
+
+FormatCache::FormatCache(size_t capacity, int shards)
+    : shard_capacity_(1), shards_(shards > 0 ? shards : 1) {
+  shard_capacity_ = (capacity + shards_.size() - 1) / shards_.size();
+  if (shard_capacity_ == 0) {
+    shard_capacity_ = 1;
+  }
+}
+
+int FormatCache::Get(std::string_view format, std::shared_ptr<const CompiledFormat>& compiled) {
+  Shard& shard = GetShard(format);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(format);
+    if (it != shard.index.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      compiled = it->second->compiled;
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return 0;
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+
+  // 解析比较慢, 不持有锁
+  auto parsed = std::make_shared<CompiledFormat>();
+  // 语法树编译后就不再需要, 用 arena 一次释放
+  FormatParser parser(false, true);
+  int ret = parser.Parse(std::string(format), *parsed);
+  if (ret != 0) {
+    return ret;
+  }
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(format);
+  if (it != shard.index.end()) {
+    // 其他线程已经插入
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    compiled = it->second->compiled;
+    return 0;
+  }
+  shard.lru.push_front(Entry{std::string(format), std::move(parsed)});
+  shard.index.emplace(shard.lru.front().format, shard.lru.begin());
+  compiled = shard.lru.front().compiled;
+
+  while (shard.lru.size() > shard_capacity_) {
+    shard.index.erase(shard.lru.back().format);
+    shard.lru.pop_back();
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return 0;
+}
+
+FormatCacheStats FormatCache::GetStats() const {
+  FormatCacheStats stats;
+  stats.hits      = hits_.load(std::memory_order_relaxed);
+  stats.misses    = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+size_t FormatCache::Size() const {
+  size_t size = 0;
+  for (auto& shard: shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    size += shard.lru.size();
+  }
+  return size;
+}
+
+void FormatCache::Clear() {
+  for (auto& shard: shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.index.clear();
+    shard.lru.clear();
+  }
+}
+
+FormatCache& FormatCache::Instance() {
+  static FormatCache cache;
+  return cache;
+}
+
+}  // namespace fq
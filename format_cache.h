@@ -0,0 +1,76 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.11
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "compiled_format.h"
+
+namespace fq {
+
+struct FormatCacheStats {
+  uint64_t hits      = 0;
+  uint64_t misses    = 0;
+  uint64_t evictions = 0;
+};
+
+// format 文本 -> 编译好的 CompiledFormat, 命中时完全跳过解析
+// 按 format 的哈希分成多个分片, 每个分片一把锁和一个 LRU 链表, 不同分片的访问互不影响
+// 解析在锁外进行, 同一个 format 并发未命中时可能解析多次, 只保留先插入的一份
+// 返回的 CompiledFormat 只读, 可以被多个线程同时使用, 被淘汰后仍由 shared_ptr 保持有效
+class FormatCache {
+ public:
+  // capacity 为总容量, 平均分给每个分片
+  explicit FormatCache(size_t capacity = 4096, int shards = 16);
+
+  FormatCache(const FormatCache&) = delete;
+  FormatCache& operator=(const FormatCache&) = delete;
+
+  // 返回 0 成功, 否则为 FormatParser::Parse 的返回值, 解析失败的 format 不缓存
+  int Get(std::string_view format, std::shared_ptr<const CompiledFormat>& compiled);
+
+  FormatCacheStats GetStats() const;
+  size_t Size() const;
+  void Clear();
+
+  // 进程内共享的实例
+  static FormatCache& Instance();
+
+ private:
+  struct Entry {
+    std::string format;
+    std::shared_ptr<const CompiledFormat> compiled;
+  };
+
+  // 链表头部是最近使用的, key 指向链表节点中的 format
+  struct Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> lru;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+  };
+
+  Shard& GetShard(std::string_view format) {
+    return shards_[std::hash<std::string_view>()(format) % shards_.size()];
+  }
+
+ private:
+  size_t shard_capacity_;
+  std::vector<Shard> shards_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+};
+
+}  // namespace fq
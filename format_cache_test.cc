@@ -0,0 +1,89 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.11
+
+#include "format_cache.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace fq;
+
+TEST(FormatCache, Get)
+{
+  FormatCache cache(2, 1);
+  std::shared_ptr<const CompiledFormat> first, second;
+  EXPECT_EQ(cache.Get("{name}|{age:int}", first), 0);
+  EXPECT_EQ(cache.Get("{name}|{age:int}", second), 0);
+  EXPECT_EQ(first.get(), second.get());
+
+  MatchResult result;
+  EXPECT_TRUE(first->Match("Alice|18", result));
+  EXPECT_EQ(result.Get("age")->typed_.i, 18);
+
+  // 解析失败不缓存
+  std::shared_ptr<const CompiledFormat> bad;
+  EXPECT_NE(cache.Get("{a:b:c:d}", bad), 0);
+  EXPECT_EQ(bad, nullptr);
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(cache.Size(), 1u);
+}
+
+TEST(FormatCache, EvictLeastRecentlyUsed)
+{
+  FormatCache cache(2, 1);
+  std::shared_ptr<const CompiledFormat> a, b, c;
+  EXPECT_EQ(cache.Get("a={a}", a), 0);
+  EXPECT_EQ(cache.Get("b={b}", b), 0);
+  EXPECT_EQ(cache.Get("a={a}", a), 0);
+  EXPECT_EQ(cache.Get("c={c}", c), 0);
+  EXPECT_EQ(cache.Size(), 2u);
+  EXPECT_EQ(cache.GetStats().evictions, 1u);
+
+  // b 被淘汰, 但仍然可以使用
+  MatchResult result;
+  EXPECT_TRUE(b->Match("b=1", result));
+  std::shared_ptr<const CompiledFormat> again;
+  EXPECT_EQ(cache.Get("b={b}", again), 0);
+  EXPECT_NE(again.get(), b.get());
+  EXPECT_EQ(cache.Get("c={c}", again), 0);
+  EXPECT_EQ(again.get(), c.get());
+  EXPECT_EQ(cache.GetStats().misses, 4u);
+
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0u);
+}
+
+TEST(FormatCache, Concurrent)
+{
+  FormatCache cache(16, 4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t]() {
+      MatchResult result;
+      for (int i = 0; i < 2000; ++i) {
+        int k = (i * 7 + t) % 24;
+        std::shared_ptr<const CompiledFormat> format;
+        ASSERT_EQ(cache.Get("k" + std::to_string(k) + "={value:int}", format), 0);
+        ASSERT_TRUE(format->Match("k" + std::to_string(k) + "=" + std::to_string(i), result));
+        ASSERT_EQ(result.Get("value")->typed_.i, i);
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits + stats.misses, 8000u);
+  EXPECT_LE(cache.Size(), 16u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,174 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.02
+
+#include "format_set.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+
+namespace fq {
+
+int MultiLiteralSearcher::Add(std::string_view literal) {
+  literals_.emplace_back(literal);
+  return (int) literals_.size() - 1;
+}
+
+// Aho-Corasick, 把失败链接展开成完整的跳转表, 扫描时每个字节只查一次表
+void MultiLiteralSearcher::Build() {
+  // 等价类 0 表示没有在任何文本中出现的字节
+  std::fill(class_of_, class_of_ + 256, 0);
+  classes_ = 1;
+  for (auto& literal: literals_) {
+    for (unsigned char ch: literal) {
+      if (class_of_[ch] == 0) {
+        class_of_[ch] = classes_++;
+      }
+    }
+  }
+
+  // trie
+  next_.assign(classes_, -1);
+  std::vector<std::vector<int>> own(1);
+  for (int id = 0; id < (int) literals_.size(); ++id) {
+    int state = 0;
+    for (unsigned char ch: literals_[id]) {
+      int& to = next_[state * classes_ + class_of_[ch]];
+      if (to < 0) {
+        to = (int) own.size();
+        own.emplace_back();
+        next_.resize(next_.size() + classes_, -1);
+      }
+      state = next_[state * classes_ + class_of_[ch]];
+    }
+    if (state != 0) {
+      own[state].push_back(id);
+    }
+  }
+
+  // 按层次补全跳转, 输出合并失败链接上的输出
+  int states = (int) own.size();
+  std::vector<int> fail(states, 0);
+  std::vector<std::vector<int>> outputs(states);
+  std::deque<int> queue;
+  queue.push_back(0);
+  while (!queue.empty()) {
+    int state = queue.front();
+    queue.pop_front();
+    outputs[state] = own[state];
+    if (state != 0) {
+      auto& inherited = outputs[fail[state]];
+      outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+    }
+    for (int c = 0; c < classes_; ++c) {
+      int& to = next_[state * classes_ + c];
+      if (to >= 0 && to != 0) {
+        fail[to] = state == 0 ? 0 : next_[fail[state] * classes_ + c];
+        queue.push_back(to);
+      } else {
+        to = state == 0 ? 0 : next_[fail[state] * classes_ + c];
+      }
+    }
+  }
+
+  output_begin_.assign(1, 0);
+  outputs_.clear();
+  for (auto& out: outputs) {
+    outputs_.insert(outputs_.end(), out.begin(), out.end());
+    output_begin_.push_back((int) outputs_.size());
+  }
+}
+
+int FormatSet::Add(const std::string& format, int* index) {
+  // 语法树编译后就不再需要, 用 arena 一次释放
+  FormatParser parser(false, true);
+  CompiledFormat compiled;
+  int ret = parser.Parse(format, compiled);
+  if (ret != 0) {
+    return ret;
+  }
+  formats_.push_back(std::move(compiled));
+  if (index != nullptr) {
+    *index = (int) formats_.size() - 1;
+  }
+  return 0;
+}
+
+void FormatSet::Build() {
+  first_byte_.assign(formats_.size(), -1);
+  keywords_ = MultiLiteralSearcher();
+  by_keyword_.clear();
+  always_.clear();
+
+  std::map<std::string, int> keyword_ids;
+  for (int i = 0; i < (int) formats_.size(); ++i) {
+    auto& format = formats_[i];
+    // 越长的文本越少出现, 用最长的必需文本作为关键字
+    const std::string* keyword = nullptr;
+    if (!format.GetPrefix().empty()) {
+      first_byte_[i] = (unsigned char) format.GetPrefix()[0];
+      keyword        = &format.GetPrefix();
+    }
+    for (int literal: format.GetRequiredLiterals()) {
+      auto& text = format.GetLiterals()[literal].GetLiteral();
+      if (keyword == nullptr || text.size() > keyword->size()) {
+        keyword = &text;
+      }
+    }
+    if (keyword == nullptr || keyword->empty()) {
+      always_.push_back(i);
+      continue;
+    }
+    auto it = keyword_ids.find(*keyword);
+    if (it == keyword_ids.end()) {
+      it = keyword_ids.emplace(*keyword, keywords_.Add(*keyword)).first;
+      by_keyword_.emplace_back();
+    }
+    by_keyword_[it->second].push_back(i);
+  }
+  keywords_.Build();
+}
+
+int FormatSet::Match(std::string_view line, MatchResult& result) const {
+  // 每个线程一份, 避免每行分配内存
+  thread_local std::vector<int> candidates;
+  thread_local std::vector<uint32_t> seen;
+  thread_local uint32_t generation = 0;
+
+  candidates.clear();
+  candidates.insert(candidates.end(), always_.begin(), always_.end());
+  int first_byte = line.empty() ? -2 : (unsigned char) line[0];
+
+  if (keywords_.Size() > 0) {
+    if (seen.size() < (size_t) keywords_.Size()) {
+      seen.resize(keywords_.Size(), 0);
+    }
+    if (++generation == 0) {
+      std::fill(seen.begin(), seen.end(), 0);
+      generation = 1;
+    }
+    keywords_.Scan(line, [&](int id) {
+      if (seen[id] != generation) {
+        seen[id] = generation;
+        for (int index: by_keyword_[id]) {
+          if (first_byte_[index] < 0 || first_byte_[index] == first_byte) {
+            candidates.push_back(index);
+          }
+        }
+      }
+    });
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+  for (int index: candidates) {
+    if (formats_[index].Match(line, result)) {
+      return index;
+    }
+  }
+  return -1;
+}
+
+}  // namespace fq
@@ -0,0 +1,82 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.02
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "compiled_format.h"
+
+namespace fq {
+
+// 多个文本同时查找, 一次扫描给出出现过的文本
+// 字节先映射到等价类, 再用 状态 x 等价类 的跳转表
+class MultiLiteralSearcher {
+ public:
+  MultiLiteralSearcher() = default;
+
+  // 返回文本编号
+  int Add(std::string_view literal);
+  void Build();
+
+  // 每找到一个文本调用一次 found(id), 同一个文本可能被报告多次
+  template <class Callback>
+  void Scan(std::string_view s, Callback&& found) const {
+    int state = 0;
+    for (unsigned char ch : s) {
+      state = next_[state * classes_ + class_of_[ch]];
+      for (int i = output_begin_[state]; i < output_begin_[state + 1]; ++i) {
+        found(outputs_[i]);
+      }
+    }
+  }
+
+  int Size() const { return (int) literals_.size(); }
+
+ private:
+  std::vector<std::string> literals_;
+  uint16_t class_of_[256] = {};
+  int classes_ = 1;
+  std::vector<int> next_;
+  // 状态 s 的输出为 outputs_[output_begin_[s], output_begin_[s+1])
+  std::vector<int> output_begin_;
+  std::vector<int> outputs_;
+};
+
+// 同时编译多个 format, 每行只尝试可能匹配的 format
+//   每个 format 取最长的必需文本(包括开头的前缀)作为关键字, 所有关键字一起扫描一遍
+//   以文本开头的 format 还要求行的第一个字节与前缀相同
+//   没有任何文本的 format: 每行都尝试
+// 候选按 format 的添加顺序尝试, 结果与逐个尝试相同
+class FormatSet {
+ public:
+  FormatSet() = default;
+
+  // 返回值同 FormatParser::Parse, 成功时 index 为 format 的下标
+  int Add(const std::string& format, int* index = nullptr);
+  // 添加完之后调用
+  void Build();
+
+  // 返回匹配成功的 format 下标, 都不匹配返回 -1
+  int Match(std::string_view line, MatchResult& result) const;
+
+  int Size() const { return (int) formats_.size(); }
+  const CompiledFormat& Get(int index) const { return formats_[index]; }
+
+ private:
+  std::vector<CompiledFormat> formats_;
+
+  // 前缀的第一个字节, 没有前缀为 -1
+  std::vector<int> first_byte_;
+  MultiLiteralSearcher keywords_;
+  // 关键字编号 -> format 下标
+  std::vector<std::vector<int>> by_keyword_;
+  std::vector<int> always_;
+};
+
+}  // namespace fq
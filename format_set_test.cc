@@ -0,0 +1,61 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.20
+
+#include "format_set.h"
+#include <gtest/gtest.h>
+
+using namespace fq;
+
+static std::string Value(const MatchResult& result, std::string_view name) {
+  auto item = result.Get(name);
+  if (item == nullptr) {
+    return "<null>";
+  }
+  return std::string(item->value_);
+}
+
+TEST(FormatSet, MatchFirstPlausible)
+{
+  FormatSet set;
+  ASSERT_EQ(set.Add("GET {url} {status:int}"), 0);
+  ASSERT_EQ(set.Add("{user} logged in from {ip}"), 0);
+  ASSERT_EQ(set.Add("{key}={value}"), 0);
+  ASSERT_EQ(set.Add("{a}{b}"), 0);
+  ASSERT_EQ(set.Add("{line}"), 0);
+  set.Build();
+
+  MatchResult result;
+  EXPECT_EQ(set.Match("GET /index 200", result), 0);
+  EXPECT_EQ(Value(result, "url"), "/index");
+  EXPECT_EQ(set.Match("GET /index ok", result), 4);
+  EXPECT_EQ(set.Match("alice logged in from 10.0.0.1", result), 1);
+  EXPECT_EQ(Value(result, "ip"), "10.0.0.1");
+  EXPECT_EQ(set.Match("a=b logged in from x", result), 1);
+  EXPECT_EQ(set.Match("a=b", result), 2);
+  EXPECT_EQ(set.Match("", result), 4);
+}
+
+TEST(MultiLiteralSearcher, Scan)
+{
+  MultiLiteralSearcher searcher;
+  std::vector<std::string> literals = {"he", "she", "his", "hers", "|"};
+  for (auto& literal : literals) {
+    searcher.Add(literal);
+  }
+  searcher.Build();
+  std::string text = "ushers|this";
+  std::vector<bool> found(literals.size());
+  searcher.Scan(text, [&](int id) { found[id] = true; });
+  for (size_t i = 0; i < literals.size(); ++i) {
+    EXPECT_EQ(found[i], text.find(literals[i]) != std::string::npos) << literals[i];
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,283 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.20
+
+#include "format_writer.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include "base64.h"
+
+namespace fq {
+
+namespace {
+
+// 追加到 string 末尾
+struct StringOut {
+  std::string& s;
+
+  void Append(std::string_view value) { s.append(value.data(), value.size()); }
+  void Fill(char c, size_t n) { s.append(n, c); }
+};
+
+// 写入定长的缓冲, 超出的部分只计数
+struct SpanOut {
+  char* buf;
+  size_t size;
+  size_t pos = 0;
+
+  void Append(std::string_view value) {
+    if (pos < size) {
+      memcpy(buf + pos, value.data(), std::min(value.size(), size - pos));
+    }
+    pos += value.size();
+  }
+  void Fill(char c, size_t n) {
+    if (pos < size) {
+      memset(buf + pos, c, std::min(n, size - pos));
+    }
+    pos += n;
+  }
+};
+
+// 按 slot 取值, slot 对应的名字不同时 (result 来自其他名字表) 按名字查找
+struct ResultGetter {
+  const MatchResult& result;
+
+  bool operator()(int slot, std::string_view name, std::string_view& value) const {
+    const ResultItem* item = result.Get(slot);
+    if (item == nullptr || item->name_ != name) {
+      item = result.Get(name);
+    }
+    if (item == nullptr) {
+      return false;
+    }
+    value = item->value_;
+    return true;
+  }
+};
+
+struct NamedGetter {
+  const FormatWriter::NamedValue* values;
+  size_t count;
+
+  bool operator()(int, std::string_view name, std::string_view& value) const {
+    for (size_t i = 0; i < count; ++i) {
+      if (values[i].first == name) {
+        value = values[i].second;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+}  // namespace
+
+int FormatParser::Parse(const std::string& str, FormatWriter& writer) {
+  FormatRootNode root;
+  int ret = Parse(str, root);
+  if (ret != 0) {
+    return ret;
+  }
+  return writer.Compile(root);
+}
+
+int FormatWriter::Compile(const FormatRootNode& root) {
+  pieces_.clear();
+  names_ = root.GetNameTable();
+  return Append(root);
+}
+
+int FormatWriter::Append(const FormatRootNode& root) {
+  for (auto& element: root.GetElements()) {
+    if (element->IsLiteral()) {
+      auto text = static_cast<const FormatLiteralNode*>(element.get())->GetToken().GetString();
+      // Raw 展开后可能出现相邻的文本, 合并
+      if (!pieces_.empty() && pieces_.back().kind == kPieceLiteral) {
+        pieces_.back().text.append(text.data(), text.size());
+      } else {
+        Piece piece(kPieceLiteral);
+        piece.text = std::string(text);
+        pieces_.push_back(std::move(piece));
+      }
+      continue;
+    }
+    auto matcher = dynamic_cast<const FormatMatcherNode*>(element.get());
+    if (matcher == nullptr) {
+      return -15;
+    }
+    auto& decl = matcher->GetDecl();
+    if (!decl) {
+      Piece piece(kPieceField);
+      piece.name  = std::string(matcher->GetName().GetString());
+      piece.type  = matcher->GetFieldType();
+      piece.slot  = matcher->GetSlot();
+      piece.width = matcher->GetWidth();
+      pieces_.push_back(std::move(piece));
+      continue;
+    }
+
+    auto name    = decl->GetName().GetString();
+    auto& params = decl->GetParams();
+    if (name == "Raw" && params.size() == 1) {
+      int ret = Append(*params[0]);
+      if (ret != 0) {
+        return ret;
+      }
+    } else if (name == "Base64" && params.size() == 1) {
+      size_t index = pieces_.size();
+      pieces_.emplace_back(kPieceBase64);
+      int ret = Append(*params[0]);
+      if (ret != 0) {
+        return ret;
+      }
+      pieces_[index].end = (int) pieces_.size();
+    } else if (name == "FKV" && params.size() == 3) {
+      // 参数已经由 FormatDeclNode::Finalize 检查过
+      Piece piece(kPieceFkv);
+      std::string* seps[2] = {&piece.text, &piece.kv_sep};
+      for (int i = 0; i < 2; ++i) {
+        for (auto& sep: params[i]->GetElements()) {
+          *seps[i] += static_cast<const FormatLiteralNode*>(sep.get())->GetToken().GetString();
+        }
+      }
+      size_t index = pieces_.size();
+      pieces_.push_back(std::move(piece));
+      for (auto& key: decl->GetFkvFields()) {
+        Piece field(kPieceField);
+        field.name  = std::string(key->GetName().GetString());
+        field.type  = key->GetFieldType();
+        field.slot  = key->GetSlot();
+        field.width = key->GetWidth();
+        pieces_.push_back(std::move(field));
+      }
+      pieces_[index].end = (int) pieces_.size();
+    } else {
+      return -15;
+    }
+  }
+  return 0;
+}
+
+template <class Getter, class Out>
+int FormatWriter::Render(int begin, int end, const Getter& get, Out& out, int depth) const {
+  auto field = [&](const Piece& piece) {
+    std::string_view value;
+    if (!get(piece.slot, piece.name, value)) {
+      value = std::string_view();
+    }
+    if (piece.width == 0) {
+      out.Append(value);
+      return 0;
+    }
+    if ((int) value.size() > piece.width) {
+      return -2;
+    }
+    size_t pad = piece.width - value.size();
+    if (piece.type == kFieldTypeStr) {
+      out.Append(value);
+      out.Fill(' ', pad);
+    } else {
+      out.Fill(' ', pad);
+      out.Append(value);
+    }
+    return 0;
+  };
+
+  for (int i = begin; i < end; ++i) {
+    const Piece& piece = pieces_[i];
+    switch (piece.kind) {
+      case kPieceLiteral:
+        out.Append(piece.text);
+        break;
+      case kPieceField: {
+        int ret = field(piece);
+        if (ret != 0) {
+          return ret;
+        }
+        break;
+      }
+      case kPieceBase64: {
+        // 每层嵌套两个缓冲: 编码前和编码后; deque 保证已有元素的地址不变
+        thread_local std::deque<std::string> buffers;
+        while ((int) buffers.size() < depth * 2 + 2) {
+          buffers.emplace_back();
+        }
+        std::string& plain   = buffers[depth * 2];
+        std::string& encoded = buffers[depth * 2 + 1];
+        plain.clear();
+        StringOut inner{plain};
+        int ret = Render(i + 1, piece.end, get, inner, depth + 1);
+        if (ret != 0) {
+          return ret;
+        }
+        encoded.clear();
+        EncodeBase64(plain, encoded);
+        out.Append(encoded);
+        i = piece.end - 1;
+        break;
+      }
+      case kPieceFkv:
+        for (int key = i + 1; key < piece.end; ++key) {
+          if (key > i + 1) {
+            out.Append(piece.text);
+          }
+          out.Append(pieces_[key].name);
+          out.Append(piece.kv_sep);
+          int ret = field(pieces_[key]);
+          if (ret != 0) {
+            return ret;
+          }
+        }
+        i = piece.end - 1;
+        break;
+    }
+  }
+  return 0;
+}
+
+template <class Getter>
+int FormatWriter::WriteString(const Getter& get, std::string& out) const {
+  size_t old = out.size();
+  StringOut writer{out};
+  int ret = Render(0, (int) pieces_.size(), get, writer, 0);
+  if (ret != 0) {
+    out.resize(old);
+  }
+  return ret;
+}
+
+template <class Getter>
+int FormatWriter::WriteBuffer(const Getter& get, char* buf, size_t size, size_t* written) const {
+  SpanOut writer{buf, size};
+  int ret = Render(0, (int) pieces_.size(), get, writer, 0);
+  if (written != nullptr) {
+    *written = writer.pos;
+  }
+  if (ret != 0) {
+    return ret;
+  }
+  return writer.pos > size ? -1 : 0;
+}
+
+int FormatWriter::Write(const MatchResult& result, std::string& out) const {
+  return WriteString(ResultGetter{result}, out);
+}
+
+int FormatWriter::Write(const NamedValue* values, size_t count, std::string& out) const {
+  return WriteString(NamedGetter{values, count}, out);
+}
+
+int FormatWriter::Write(const MatchResult& result, char* buf, size_t size, size_t* written) const {
+  return WriteBuffer(ResultGetter{result}, buf, size, written);
+}
+
+int FormatWriter::Write(const NamedValue* values, size_t count, char* buf, size_t size, size_t* written) const {
+  return WriteBuffer(NamedGetter{values, count}, buf, size, written);
+}
+
+}  // namespace fq
@@ -0,0 +1,89 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.20
+
+#pragma once
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "matcher.h"
+
+namespace fq {
+
+// 与匹配相反: 把字段值按同一个 format 写回文本
+//   FormatParser parser;
+//   FormatWriter writer;
+//   parser.Parse("{name}|{age:int}", writer);
+//   writer.Write(result, out);          // result 来自同一个 format 的匹配
+//   writer.Write({{"name", "a"}, {"age", "1"}}, out);
+//   writer.Write(values.data(), values.size(), out);  // 运行期组装的 NamedValue 数组
+// 字段值原样写出, 缺少的字段写为空; Raw 展开, Base64 先写内部再编码, FKV 按声明顺序写出每个 key
+// 定宽字段补空格: 数值右对齐, 字符串左对齐
+// 写出时不为字段分配内存, 只有 Base64 使用线程内复用的缓冲
+class FormatWriter {
+ public:
+  using NamedValue = std::pair<std::string_view, std::string_view>;
+
+  FormatWriter() = default;
+
+  // 返回 -15 未知的 decl
+  int Compile(const FormatRootNode& root);
+
+  // 追加到 out 末尾, 返回 0 成功, -2 值超过定宽字段的宽度, 此时 out 不变
+  int Write(const MatchResult& result, std::string& out) const;
+  // values 中同名的取第一个
+  int Write(const NamedValue* values, size_t count, std::string& out) const;
+  int Write(std::initializer_list<NamedValue> values, std::string& out) const {
+    return Write(values.begin(), values.size(), out);
+  }
+
+  // 写入调用方的缓冲, *written 为需要的长度
+  // 返回 -1 缓冲不够, 此时 buf 中的内容不完整; -2 同上
+  int Write(const MatchResult& result, char* buf, size_t size, size_t* written) const;
+  int Write(const NamedValue* values, size_t count, char* buf, size_t size, size_t* written) const;
+
+  const NameTable& GetNameTable() const { return names_; }
+
+ private:
+  enum PieceKind {
+    kPieceLiteral = 0,
+    kPieceField   = 1,
+    kPieceBase64  = 2,  // 内部为 [i + 1, end)
+    kPieceFkv     = 3,  // 内部为 [i + 1, end), 都是字段, 分隔符为 text 和 kv_sep
+  };
+
+  struct Piece {
+    explicit Piece(PieceKind k) : kind(k) {}
+
+    PieceKind kind;
+    // 文本, FKV 的 pair_sep
+    std::string text;
+    // 字段
+    std::string name;
+    FieldType type = kFieldTypeStr;
+    int slot       = -1;
+    int width      = 0;
+    // Base64/FKV
+    int end = 0;
+    std::string kv_sep;
+  };
+
+  int Append(const FormatRootNode& root);
+
+  template <class Getter, class Out>
+  int Render(int begin, int end, const Getter& get, Out& out, int depth) const;
+  template <class Getter>
+  int WriteString(const Getter& get, std::string& out) const;
+  template <class Getter>
+  int WriteBuffer(const Getter& get, char* buf, size_t size, size_t* written) const;
+
+  std::vector<Piece> pieces_;
+  NameTable names_;
+};
+
+}  // namespace fq
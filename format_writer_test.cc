@@ -0,0 +1,102 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.20
+
+#include "format_writer.h"
+#include <gtest/gtest.h>
+#include "compiled_format.h"
+
+using namespace fq;
+
+TEST(FormatWriter, RoundTrip)
+{
+  struct Case {
+    const char* format;
+    const char* source;
+  } cases[] = {
+    {"{name}|{age:int}|{city}", "Alice|18|Shenzhen"},
+    {"[{id:int}]{Raw({name}|{age:int})}", "[7]Bob|20"},
+    {"{name}:{Base64({age:int}|{sex})}", "Alice:MTh8Rg=="},
+    {"{name}|{FKV(&,=,{sex}{age:int})}|{tail}", "Alice|sex=F&age=18|end"},
+    {"{id:int:04}{code:02}|{amount:float:08}", "  42US|   12.50"},
+    {"{code:04}|{Base64({x}-{Raw({y:int:03})})}", "ab  |YS0gIDE="},
+  };
+  FormatParser parser;
+  for (auto& c : cases) {
+    CompiledFormat compiled;
+    FormatWriter writer;
+    ASSERT_EQ(parser.Parse(c.format, compiled), 0) << c.format;
+    ASSERT_EQ(parser.Parse(c.format, writer), 0) << c.format;
+    MatchResult result;
+    ASSERT_TRUE(compiled.Match(c.source, result)) << c.format;
+
+    std::string out = "x";
+    EXPECT_EQ(writer.Write(result, out), 0);
+    EXPECT_EQ(out, std::string("x") + c.source) << c.format;
+
+    // 调用方的缓冲: 太小时返回 -1 并给出需要的长度
+    char buf[64];
+    size_t written = 0;
+    EXPECT_EQ(writer.Write(result, buf, 3, &written), -1);
+    EXPECT_EQ(written, strlen(c.source));
+    EXPECT_EQ(writer.Write(result, buf, sizeof(buf), &written), 0);
+    EXPECT_EQ(std::string(buf, written), c.source) << c.format;
+  }
+}
+
+TEST(FormatWriter, NamedValues)
+{
+  FormatParser parser;
+  FormatWriter writer;
+  ASSERT_EQ(parser.Parse("{name}|{FKV(&,=,{sex}{age:int})}|{id:int:04}", writer), 0);
+
+  std::string out;
+  EXPECT_EQ(writer.Write({{"age", "18"}, {"name", "Alice"}, {"id", "7"}}, out), 0);
+  EXPECT_EQ(out, "Alice|sex=&age=18|   7");
+
+  // 超过定宽时不写出任何内容
+  out = "x";
+  EXPECT_EQ(writer.Write({{"id", "12345"}}, out), -2);
+  EXPECT_EQ(out, "x");
+
+  // 名字表不同的 result 按名字取值
+  CompiledFormat other;
+  ASSERT_EQ(parser.Parse("{id}/{sex}/{name}", other), 0);
+  MatchResult result;
+  ASSERT_TRUE(other.Match("42/M/Bob", result));
+  out.clear();
+  EXPECT_EQ(writer.Write(result, out), 0);
+  EXPECT_EQ(out, "Bob|sex=M&age=|  42");
+
+  // 运行期组装的数组和调用方的缓冲
+  std::vector<FormatWriter::NamedValue> values;
+  values.emplace_back("name", "Carol");
+  values.emplace_back("sex", "F");
+  values.emplace_back("id", "3");
+  out.clear();
+  EXPECT_EQ(writer.Write(values.data(), values.size(), out), 0);
+  EXPECT_EQ(out, "Carol|sex=F&age=|   3");
+
+  char buf[64];
+  size_t written = 0;
+  EXPECT_EQ(writer.Write(values.data(), values.size(), buf, 4, &written), -1);
+  EXPECT_EQ(written, out.size());
+  EXPECT_EQ(writer.Write(values.data(), values.size(), buf, sizeof(buf), &written), 0);
+  EXPECT_EQ(std::string(buf, written), out);
+  values.emplace_back("id", "x");  // 同名的取第一个
+  EXPECT_EQ(writer.Write(values.data(), values.size(), buf, sizeof(buf), &written), 0);
+  EXPECT_EQ(std::string(buf, written), out);
+  values[2].second = "12345";
+  EXPECT_EQ(writer.Write(values.data(), values.size(), buf, sizeof(buf), &written), -2);
+
+  FormatWriter bad;
+  EXPECT_EQ(parser.Parse("{Gzip({a})}", bad), -15);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.24
+
+#include "literal_search.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FQ_HAVE_X86 1
+#endif
+
+namespace fq {
+
+namespace {
+
+constexpr size_t npos = LiteralSearcher::npos;
+
+size_t FindEmpty(const char*, size_t, const char*, size_t) {
+  return 0;
+}
+
+size_t FindByteScalar(const char* s, size_t n, const char* literal, size_t) {
+  const void* p = memchr(s, literal[0], n);
+  return p == nullptr ? npos : (const char*) p - s;
+}
+
+size_t FindMultiScalar(const char* s, size_t n, const char* literal, size_t size) {
+  return std::string_view(s, n).find(std::string_view(literal, size));
+}
+
+#ifdef FQ_HAVE_X86
+
+size_t FindByteSse2(const char* s, size_t n, const char* literal, size_t size) {
+  const __m128i needle = _mm_set1_epi8(literal[0]);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*) (s + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  size_t found = FindByteScalar(s + i, n - i, literal, size);
+  return found == npos ? npos : found + i;
+}
+
+size_t FindMultiSse2(const char* s, size_t n, const char* literal, size_t size) {
+  const __m128i first = _mm_set1_epi8(literal[0]);
+  const __m128i last  = _mm_set1_epi8(literal[size - 1]);
+  size_t i = 0;
+  for (; i + size - 1 + 16 <= n; i += 16) {
+    __m128i block_first = _mm_loadu_si128((const __m128i*) (s + i));
+    __m128i block_last  = _mm_loadu_si128((const __m128i*) (s + i + size - 1));
+    unsigned mask       = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      unsigned bit = __builtin_ctz(mask);
+      if (memcmp(s + i + bit + 1, literal + 1, size - 2) == 0) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+  size_t found = FindMultiScalar(s + i, n - i, literal, size);
+  return found == npos ? npos : found + i;
+}
+
+__attribute__((target("avx2"))) size_t FindByteAvx2(const char* s, size_t n, const char* literal, size_t size) {
+  const __m256i needle = _mm256_set1_epi8(literal[0]);
+  size_t i = 0;
+  // 每次处理 64 字节, 两次比较合并后再判断是否命中
+  for (; i + 64 <= n; i += 64) {
+    __m256i eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (s + i)), needle);
+    __m256i eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (s + i + 32)), needle);
+    if (!_mm256_testz_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq0, eq1))) {
+      unsigned mask0 = _mm256_movemask_epi8(eq0);
+      if (mask0 != 0) {
+        return i + __builtin_ctz(mask0);
+      }
+      return i + 32 + __builtin_ctz((unsigned) _mm256_movemask_epi8(eq1));
+    }
+  }
+  for (; i + 32 <= n; i += 32) {
+    unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (s + i)), needle));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  size_t found = FindByteSse2(s + i, n - i, literal, size);
+  return found == npos ? npos : found + i;
+}
+
+__attribute__((target("avx2"))) size_t FindMultiAvx2(const char* s, size_t n, const char* literal, size_t size) {
+  const __m256i first = _mm256_set1_epi8(literal[0]);
+  const __m256i last  = _mm256_set1_epi8(literal[size - 1]);
+  size_t i = 0;
+  for (; i + size - 1 + 32 <= n; i += 32) {
+    __m256i block_first = _mm256_loadu_si256((const __m256i*) (s + i));
+    __m256i block_last  = _mm256_loadu_si256((const __m256i*) (s + i + size - 1));
+    unsigned mask       = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+    while (mask != 0) {
+      unsigned bit = __builtin_ctz(mask);
+      if (memcmp(s + i + bit + 1, literal + 1, size - 2) == 0) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+  size_t found = FindMultiSse2(s + i, n - i, literal, size);
+  return found == npos ? npos : found + i;
+}
+
+#endif  // FQ_HAVE_X86
+
+}  // namespace
+
+SimdLevel DetectSimdLevel() {
+#ifdef FQ_HAVE_X86
+  static const SimdLevel level = __builtin_cpu_supports("avx2") ? kSimdAvx2 : kSimdSse2;
+  return level;
+#else
+  return kSimdScalar;
+#endif
+}
+
+LiteralSearcher::LiteralSearcher(std::string_view literal) : LiteralSearcher(literal, DetectSimdLevel()) {}
+
+LiteralSearcher::LiteralSearcher(std::string_view literal, SimdLevel level) : literal_(literal) {
+  if (literal_.empty()) {
+    find_ = FindEmpty;
+    return;
+  }
+  bool single = literal_.size() == 1;
+#ifdef FQ_HAVE_X86
+  if (level >= kSimdAvx2 && DetectSimdLevel() >= kSimdAvx2) {
+    find_ = single ? FindByteAvx2 : FindMultiAvx2;
+    return;
+  }
+  if (level >= kSimdSse2) {
+    find_ = single ? FindByteSse2 : FindMultiSse2;
+    return;
+  }
+#endif
+  find_ = single ? FindByteScalar : FindMultiScalar;
+}
+
+}  // namespace fq
@@ -0,0 +1,88 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.24
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace fq {
+
+// 指令集级别, 运行时检测
+enum SimdLevel {
+  kSimdScalar = 0,
+  kSimdSse2   = 1,
+  kSimdAvx2   = 2,
+};
+
+SimdLevel DetectSimdLevel();
+
+// 字节在日志类文本中出现频率的粗略等级, 越小越少见, 用于挑选预先 memchr 的字节
+constexpr uint8_t ByteFrequency(unsigned char ch) {
+  if (ch == ' ') {
+    return 255;
+  }
+  if (ch == 'e' || ch == 't' || ch == 'a' || ch == 'o' || ch == 'i' || ch == 'n' || ch == 's' || ch == 'r') {
+    return 220;
+  }
+  if (ch >= '0' && ch <= '9') {
+    return 210;
+  }
+  if (ch >= 'a' && ch <= 'z') {
+    return 180;
+  }
+  if (ch == '.' || ch == '/' || ch == ':' || ch == '-' || ch == '_' || ch == ',' || ch == '=' || ch == '\t') {
+    return 170;
+  }
+  if (ch >= 'A' && ch <= 'Z') {
+    return 140;
+  }
+  if (ch == '"' || ch == '&' || ch == '?' || ch == '|' || ch == ';' || ch == '(' || ch == ')' || ch == '[' ||
+      ch == ']') {
+    return 110;
+  }
+  if (ch >= 0x80) {
+    return 50;
+  }
+  if (ch < 0x20) {
+    return 5;
+  }
+  return 60;
+}
+
+// 文本查找, 查找策略在构造时(即解析 format 时)确定:
+//   单字节文本: 类似 memchr, 每次比较 16/32 个字节
+//   多字节文本: 同时比较首字节和尾字节, 命中后再比较中间部分
+class LiteralSearcher {
+ public:
+  LiteralSearcher() : LiteralSearcher(std::string_view()) {}
+  explicit LiteralSearcher(std::string_view literal);
+  LiteralSearcher(std::string_view literal, SimdLevel level);
+
+  // 在 s 的 [start, s.size()) 中查找, 返回文本开头的位置, 找不到返回 npos
+  size_t Find(std::string_view s, size_t start = 0) const {
+    if (start > s.size()) {
+      return npos;
+    }
+    size_t found = find_(s.data() + start, s.size() - start, literal_.data(), literal_.size());
+    return found == npos ? npos : found + start;
+  }
+
+  const std::string& GetLiteral() const { return literal_; }
+  size_t Size() const { return literal_.size(); }
+
+  static constexpr size_t npos = std::string_view::npos;
+
+ private:
+  using FindFunc = size_t (*)(const char* s, size_t n, const char* literal, size_t size);
+
+  std::string literal_;
+  FindFunc find_ = nullptr;
+};
+
+}  // namespace fq
@@ -0,0 +1,66 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.24
+
+#include "literal_search.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace fq;
+
+static void ExpectSameAsFind(std::string_view s, std::string_view literal) {
+  for (auto level : {kSimdScalar, kSimdSse2, kSimdAvx2}) {
+    LiteralSearcher searcher(literal, level);
+    for (size_t start = 0; start <= s.size(); ++start) {
+      ASSERT_EQ(searcher.Find(s, start), s.find(literal, start))
+          << "level=" << level << " literal=" << literal << " start=" << start;
+    }
+  }
+}
+
+TEST(LiteralSearcher, HandleSimple)
+{
+  ExpectSameAsFind("Alice|18", "|");
+  ExpectSameAsFind("Alice|18", ", ");
+  ExpectSameAsFind("Alice, 18, F", ", ");
+  ExpectSameAsFind("abc", "");
+  ExpectSameAsFind("", "|");
+  ExpectSameAsFind("ab", "abc");
+}
+
+TEST(LiteralSearcher, HandleLongLine)
+{
+  std::string line(300, 'x');
+  line[70]  = '|';
+  line[200] = '\t';
+  line.replace(250, 3, "<=>");
+  ExpectSameAsFind(line, "|");
+  ExpectSameAsFind(line, "\t");
+  ExpectSameAsFind(line, "<=>");
+  ExpectSameAsFind(line, "x<");
+  ExpectSameAsFind(line, "not found");
+}
+
+TEST(LiteralSearcher, HandleRandom)
+{
+  std::mt19937 rng(20220324);
+  for (int round = 0; round < 200; ++round) {
+    std::string s(rng() % 200, 'a');
+    for (auto& ch : s) {
+      ch = "ab|, "[rng() % 5];
+    }
+    std::string literal(1 + rng() % 4, 'a');
+    for (auto& ch : literal) {
+      ch = "ab|, "[rng() % 5];
+    }
+    ExpectSameAsFind(s, literal);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
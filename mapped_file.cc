@@ -0,0 +1,51 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.28
+
+#include "mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fq {
+
+int MappedFile::Open(const std::string& path) {
+  Close();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -2;
+  }
+  if (st.st_size == 0) {
+    // 空文件不能 mmap
+    close(fd);
+    return 0;
+  }
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return -3;
+  }
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  data_ = (const char*) data;
+  size_ = st.st_size;
+  return 0;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap((void*) data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace fq
@@ -0,0 +1,34 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.28
+
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace fq {
+
+// 只读映射整个文件
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // 成功返回 0, 打开失败 -1, 获取大小失败 -2, 映射失败 -3
+  int Open(const std::string& path);
+  void Close();
+
+  std::string_view Data() const { return std::string_view(data_, size_); }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_      = 0;
+};
+
+}  // namespace fq
@@ -0,0 +1,43 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.28
+
+#pragma once
+#include <string_view>
+#include "compiled_format.h"
+#include "literal_search.h"
+
+namespace fq {
+
+// 按行匹配 buffer, 每一行调用一次 callback(line, matched, result)
+// 行不会被拷贝, line 和 result 中的 value 都指向 buffer; 行尾的 "\r" 会被去掉
+// result 在每一行之间复用, callback 返回后其内容失效
+// 返回匹配成功的行数
+template <class Callback>
+size_t MatchLines(const CompiledFormat& format, std::string_view buffer, MatchResult& result, Callback&& callback) {
+  static const LiteralSearcher newline("\n");
+  size_t matched = 0;
+  size_t pos     = 0;
+  while (pos < buffer.size()) {
+    size_t end = newline.Find(buffer, pos);
+    if (end == LiteralSearcher::npos) {
+      end = buffer.size();
+    }
+    auto line = buffer.substr(pos, end - pos);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    bool ok = format.Match(line, result);
+    if (ok) {
+      ++matched;
+    }
+    callback(line, ok, result);
+    pos = end + 1;
+  }
+  return matched;
+}
+
+}  // namespace fq
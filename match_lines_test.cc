@@ -0,0 +1,39 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.20
+
+#include "match_lines.h"
+#include "matcher.h"
+#include <gtest/gtest.h>
+
+using namespace fq;
+
+TEST(MatchLines, HandleBuffer)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", compiled), 0);
+
+  std::string buffer = "Alice|18\r\nBob|x\n\nCarol|20";
+  std::vector<std::string> names;
+  int lines = 0;
+  MatchResult result;
+  size_t matched = MatchLines(compiled, buffer, result, [&](std::string_view, bool ok, const MatchResult& r) {
+    ++lines;
+    if (ok) {
+      EXPECT_GE(r.Get("name")->value_.data(), buffer.data());
+      names.emplace_back(r.Get("name")->value_);
+    }
+  });
+  EXPECT_EQ(matched, 2u);
+  EXPECT_EQ(lines, 4);
+  EXPECT_EQ(names, (std::vector<std::string>{"Alice", "Carol"}));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,201 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.19
+
+#include "match_stats.h"
+#include <cinttypes>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "compiled_format.h"
+
+namespace fq {
+
+namespace {
+
+struct StatRegistry {
+  std::mutex mutex;
+  std::vector<StatBlock*> blocks;
+  // 已退出线程的计数
+  uint64_t retired[kStatCounterCount] = {};
+  // ResetMatchStats 时的计数
+  uint64_t baseline[kStatCounterCount] = {};
+  // 同上, 指令计数
+  std::unordered_map<uint64_t, std::vector<uint64_t>> retired_nodes;
+  std::unordered_map<uint64_t, std::vector<uint64_t>> baseline_nodes;
+};
+
+// 线程退出时可能晚于静态对象析构, 不释放
+StatRegistry& Registry() {
+  static StatRegistry* registry = new StatRegistry();
+  return *registry;
+}
+
+// 调用方持有 mutex
+void Sum(StatRegistry& registry, uint64_t* total) {
+  for (int i = 0; i < kStatCounterCount; ++i) {
+    total[i] = registry.retired[i];
+  }
+  for (auto block: registry.blocks) {
+    for (int i = 0; i < kStatCounterCount; ++i) {
+      total[i] += block->counters[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// 调用方持有 mutex, 结果不减去 baseline
+void SumNodes(StatRegistry& registry, uint64_t id, std::vector<uint64_t>& total) {
+  auto retired = registry.retired_nodes.find(id);
+  if (retired != registry.retired_nodes.end()) {
+    for (size_t i = 0; i < retired->second.size() && i < total.size(); ++i) {
+      total[i] += retired->second[i];
+    }
+  }
+  for (auto block: registry.blocks) {
+    std::lock_guard<std::mutex> lock(block->mutex);
+    auto it = block->nodes.find(id);
+    if (it == block->nodes.end()) {
+      continue;
+    }
+    for (size_t i = 0; i < it->second.size() && i < total.size(); ++i) {
+      total[i] += it->second[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+std::atomic<uint64_t> next_stat_id{1};
+
+}  // namespace
+
+uint64_t NewStatId() { return next_stat_id.fetch_add(1, std::memory_order_relaxed); }
+
+std::vector<uint64_t> GetNodeStats(uint64_t id, size_t count) {
+  std::vector<uint64_t> total(count, 0);
+  StatRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  SumNodes(registry, id, total);
+  auto baseline = registry.baseline_nodes.find(id);
+  if (baseline != registry.baseline_nodes.end()) {
+    for (size_t i = 0; i < count && i < baseline->second.size(); ++i) {
+      total[i] -= baseline->second[i];
+    }
+  }
+  return total;
+}
+
+std::atomic<uint64_t>* StatBlock::GetNodes(uint64_t id, size_t count) {
+  auto it = nodes.find(id);
+  if (it == nodes.end()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    it = nodes.emplace(id, std::vector<std::atomic<uint64_t>>(count)).first;
+    for (auto& value: it->second) {
+      value.store(0, std::memory_order_relaxed);
+    }
+  }
+  return it->second.data();
+}
+
+StatBlock::StatBlock() {
+  for (auto& counter: counters) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+  StatRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.blocks.push_back(this);
+}
+
+StatBlock::~StatBlock() {
+  StatRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (int i = 0; i < kStatCounterCount; ++i) {
+    registry.retired[i] += counters[i].load(std::memory_order_relaxed);
+  }
+  for (auto& node: nodes) {
+    auto& retired = registry.retired_nodes[node.first];
+    retired.resize(node.second.size(), 0);
+    for (size_t i = 0; i < node.second.size(); ++i) {
+      retired[i] += node.second[i].load(std::memory_order_relaxed);
+    }
+  }
+  registry.blocks.erase(std::find(registry.blocks.begin(), registry.blocks.end(), this));
+}
+
+MatchStats GetMatchStats() {
+  MatchStats stats;
+  StatRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  Sum(registry, stats.counters);
+  for (int i = 0; i < kStatCounterCount; ++i) {
+    stats.counters[i] -= registry.baseline[i];
+  }
+  return stats;
+}
+
+void ResetMatchStats() {
+  StatRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  Sum(registry, registry.baseline);
+  // 所有出现过的 format
+  std::unordered_map<uint64_t, size_t> ids;
+  for (auto& node: registry.retired_nodes) {
+    ids[node.first] = node.second.size();
+  }
+  for (auto block: registry.blocks) {
+    std::lock_guard<std::mutex> block_lock(block->mutex);
+    for (auto& node: block->nodes) {
+      ids[node.first] = node.second.size();
+    }
+  }
+  registry.baseline_nodes.clear();
+  for (auto& id: ids) {
+    auto& baseline = registry.baseline_nodes[id.first];
+    baseline.assign(id.second, 0);
+    SumNodes(registry, id.first, baseline);
+  }
+}
+
+const char* GetStatFailureName(int reason) {
+  static const char* names[] = {"literal not found", "past stop", "not anchored",
+                                "decl failed", "convert", "adjacent fields", "prefilter"};
+  static_assert(sizeof(names) / sizeof(names[0]) == kStatFailureCount, "fq: missing failure name");
+  if (reason < 0 || reason >= kStatFailureCount) {
+    return "unknown";
+  }
+  return names[reason];
+}
+
+void MatchStats::Print(FILE* out) const {
+  static const char* decls[] = {"Raw", "Base64", "FKV"};
+  if (!kStatsEnabled) {
+    fprintf(out, "stats are disabled, rebuild with -DFQ_ENABLE_STATS\n");
+    return;
+  }
+  fprintf(out, "matches: %" PRIu64 " matched: %" PRIu64 " handles: %" PRIu64 " tokens: %" PRIu64 "\n",
+          Get(kStatMatches), Get(kStatMatched), Get(kStatHandles), Get(kStatTokens));
+  fprintf(out, "literal bytes scanned: %" PRIu64 "\n", Get(kStatLiteralBytes));
+  fprintf(out, "instructions:\n");
+  for (int op = 1; op < kStatOpCount; ++op) {
+    if (Get(kStatOp + op) > 0) {
+      fprintf(out, "  %-18s %" PRIu64 "\n", GetOpName(op), Get(kStatOp + op));
+    }
+  }
+  fprintf(out, "failures:\n");
+  for (int reason = 0; reason < kStatFailureCount; ++reason) {
+    if (Get(kStatFailure + reason) > 0) {
+      fprintf(out, "  %-18s %" PRIu64 "\n", GetStatFailureName(reason), Get(kStatFailure + reason));
+    }
+  }
+  fprintf(out, "decls:\n");
+  for (int kind = 0; kind < kStatDeclCount; ++kind) {
+    uint64_t calls = Get(kStatDeclCalls + kind);
+    if (calls > 0) {
+      fprintf(out, "  %-18s %" PRIu64 " calls, %.1f ns/call\n", decls[kind], calls,
+              (double) Get(kStatDeclNanos + kind) / calls);
+    }
+  }
+}
+
+}  // namespace fq
@@ -0,0 +1,154 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.19
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// 匹配过程的计数, 只有编译时定义了 FQ_ENABLE_STATS 才统计, 否则 FQ_STAT_* 展开为空
+//
+//   g++ -DFQ_ENABLE_STATS ...
+//   fq::GetMatchStats().Print(stderr);
+//
+// 每个线程写自己的计数器, 不需要原子的读-改-写; 读取时汇总所有线程, 线程退出时计数并入全局
+// CompiledFormat 每条指令的计数也按线程保存, 以 format 的 stats id 区分
+// 所有编译单元应使用相同的 FQ_ENABLE_STATS 设置
+
+#ifdef FQ_ENABLE_STATS
+#define FQ_STAT_ADD(counter, n) ::fq::StatAdd((counter), (n))
+#define FQ_STAT_NOW() ::fq::StatNow()
+#else
+#define FQ_STAT_ADD(counter, n) ((void) 0)
+#define FQ_STAT_NOW() ((uint64_t) 0)
+#endif
+
+#define FQ_STAT_FAIL(reason) FQ_STAT_ADD(::fq::kStatFailure + (reason), 1)
+#define FQ_STAT_DECL(kind, start)                                   \
+  do {                                                              \
+    FQ_STAT_ADD(::fq::kStatDeclCalls + (kind), 1);                  \
+    FQ_STAT_ADD(::fq::kStatDeclNanos + (kind), FQ_STAT_NOW() - (start)); \
+  } while (0)
+
+namespace fq {
+
+#ifdef FQ_ENABLE_STATS
+constexpr bool kStatsEnabled = true;
+#else
+constexpr bool kStatsEnabled = false;
+#endif
+
+// 匹配失败的原因
+enum StatFailure {
+  kStatLiteralNotFound = 0,  // 查找文本没有找到
+  kStatPastStop        = 1,  // 文本或定宽字段超出了当前窗口
+  kStatNotAnchored     = 2,  // 文本没有出现在当前位置
+  kStatDeclFailed      = 3,  // Base64 解码失败, FKV 缺少 key, 未知的 decl
+  kStatConvert         = 4,  // 值不符合字段类型
+  kStatAdjacent        = 5,  // 两个字段相邻, format 本身无法匹配
+  kStatPrefilter       = 6,  // 被 FormatSummary 排除, 没有执行匹配
+  kStatFailureCount    = 7,
+};
+
+enum StatDecl {
+  kStatDeclRaw    = 0,
+  kStatDeclBase64 = 1,
+  kStatDeclFkv    = 2,
+  kStatDeclCount  = 3,
+};
+
+// 指令类型的个数上限, 与 OpCode 对应
+constexpr int kStatOpCount = 16;
+
+// 所有计数器在一个数组中的下标
+enum StatCounter {
+  kStatMatches      = 0,   // CompiledFormat::Match 调用次数
+  kStatMatched      = 1,   // 其中成功的次数
+  kStatHandles      = 2,   // FormatRootNode::Handle 调用次数, 包括 decl 内部的
+  kStatTokens       = 3,   // Tokenizer 产生的 token 数
+  kStatLiteralBytes = 4,   // 查找文本扫描过的字节数
+  kStatOp           = 5,   // + OpCode, 每种指令的执行次数
+  kStatFailure      = kStatOp + kStatOpCount,            // + StatFailure
+  kStatDeclCalls    = kStatFailure + kStatFailureCount,  // + StatDecl
+  kStatDeclNanos    = kStatDeclCalls + kStatDeclCount,   // + StatDecl, decl 内部的耗时
+  kStatCounterCount = kStatDeclNanos + kStatDeclCount,
+};
+
+// CompiledFormat 每条指令的计数, 见 CompiledFormat::GetNodeStat
+enum StatNodeCounter {
+  kStatNodeCalls   = 0,  // 执行次数
+  kStatNodeScanned = 1,  // FindLiteral 扫描过的字节数
+  kStatNodeNanos   = 2,  // EnterDecl 到 LeaveDecl, Fkv 的耗时
+  kStatNodeFailure = 3,  // + StatFailure, 在这条指令上失败的次数
+  kStatNodeCount   = kStatNodeFailure + kStatFailureCount,
+};
+
+const char* GetStatFailureName(int reason);
+
+// 每个编译好的 format 一个, 从 1 开始, 不会重复
+uint64_t NewStatId();
+// stats id 为 id 的 format 的前 count 个指令计数, 下标为 pc * kStatNodeCount + StatNodeCounter
+std::vector<uint64_t> GetNodeStats(uint64_t id, size_t count);
+
+// 某一时刻所有线程的计数之和
+struct MatchStats {
+  uint64_t counters[kStatCounterCount] = {};
+
+  uint64_t Get(int counter) const { return counters[counter]; }
+  void Print(FILE* out) const;
+};
+
+// 返回上次 ResetMatchStats 之后的计数, 指令计数同样从 ResetMatchStats 开始
+MatchStats GetMatchStats();
+void ResetMatchStats();
+
+// 每个线程一份, 只由所属线程写
+struct StatBlock {
+  std::atomic<uint64_t> counters[kStatCounterCount];
+  // stats id -> 指令计数; 只由所属线程插入, 插入和其他线程读取时持有 mutex
+  // vector 的内存在插入其他 format 时不会移动
+  std::mutex mutex;
+  std::unordered_map<uint64_t, std::vector<std::atomic<uint64_t>>> nodes;
+
+  StatBlock();
+  ~StatBlock();
+
+  std::atomic<uint64_t>* GetNodes(uint64_t id, size_t count);
+};
+
+inline StatBlock& LocalStatBlock() {
+  thread_local StatBlock block;
+  return block;
+}
+
+inline void StatAdd(std::atomic<uint64_t>& value, uint64_t n) {
+  value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void StatAdd(int counter, uint64_t n) { StatAdd(LocalStatBlock().counters[counter], n); }
+
+// 本线程中 format id 的指令计数, 连续匹配同一个 format 时不查表
+inline std::atomic<uint64_t>* LocalNodeStats(uint64_t id, size_t count) {
+  thread_local uint64_t last_id = 0;
+  thread_local std::atomic<uint64_t>* last = nullptr;
+  if (id != last_id) {
+    last    = LocalStatBlock().GetNodes(id, count);
+    last_id = id;
+  }
+  return last;
+}
+
+inline uint64_t StatNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace fq
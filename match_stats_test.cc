@@ -0,0 +1,149 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.19
+
+#include "match_stats.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include "compiled_format.h"
+
+using namespace fq;
+
+// 需要用 -DFQ_ENABLE_STATS 编译所有文件, 否则只检查计数为 0
+TEST(MatchStats, CompiledFormat)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}|{Base64({city})}", compiled), 0);
+  ResetMatchStats();
+
+  MatchResult result;
+  EXPECT_TRUE(compiled.Match("Alice|18|UGFyaXM=", result));
+  EXPECT_FALSE(compiled.Match("Alice-18", result));
+  EXPECT_FALSE(compiled.Match("Alice|x|UGFyaXM=", result));
+  EXPECT_FALSE(compiled.Match("Alice|18|!!!", result));
+  // 其他线程的计数也会被汇总
+  std::thread([&] {
+    MatchResult local;
+    compiled.Match("Bob|20|UGFyaXM=", local);
+  }).join();
+
+  MatchStats stats = GetMatchStats();
+  if (!kStatsEnabled) {
+    EXPECT_EQ(stats.Get(kStatMatches), 0u);
+    return;
+  }
+  EXPECT_EQ(stats.Get(kStatMatches), 5u);
+  EXPECT_EQ(stats.Get(kStatMatched), 2u);
+  // "Alice-18" 中没有 '|', 被 FormatSummary 直接排除
+  EXPECT_EQ(stats.Get(kStatFailure + kStatPrefilter), 1u);
+  EXPECT_EQ(stats.Get(kStatFailure + kStatConvert), 1u);
+  EXPECT_EQ(stats.Get(kStatFailure + kStatDeclFailed), 1u);
+  EXPECT_EQ(stats.Get(kStatDeclCalls + kStatDeclBase64), 2u);
+  EXPECT_EQ(stats.Get(kStatOp + kOpMatch), 2u);
+  EXPECT_GT(stats.Get(kStatLiteralBytes), 0u);
+
+  ResetMatchStats();
+  EXPECT_EQ(GetMatchStats().Get(kStatMatches), 0u);
+}
+
+TEST(MatchStats, PerInstruction)
+{
+  const std::string text = "{name}|{age:int}|{Base64({city})}";
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse(text, compiled), 0);
+
+  MatchResult result;
+  EXPECT_TRUE(compiled.Match("Alice|18|UGFyaXM=", result));
+  EXPECT_FALSE(compiled.Match("Alice|x|UGFyaXM=", result));
+  EXPECT_FALSE(compiled.Match("Alice|18|!!!", result));
+  EXPECT_FALSE(compiled.Match("Alice|18", result));
+
+  // 按 format 文本中的位置找到指令
+  auto find = [](const CompiledFormat& format, OpCode op, int pos) {
+    for (int pc = 0; pc < (int) format.GetProgram().size(); ++pc) {
+      if (format.GetProgram()[pc].op == op && format.GetSourcePos(pc) == pos) {
+        return pc;
+      }
+    }
+    return -1;
+  };
+  int first = find(compiled, kOpFindLiteral, 6);
+  int age   = find(compiled, kOpCapture, (int) text.find("age"));
+  int last  = find(compiled, kOpFindLiteral, 16);
+  int base  = find(compiled, kOpEnterDecl, (int) text.find("Base64"));
+  ASSERT_GE(first, 0);
+  ASSERT_GE(age, 0);
+  ASSERT_GE(last, 0);
+  ASSERT_GE(base, 0);
+  if (!kStatsEnabled) {
+    EXPECT_EQ(compiled.GetNodeStat(first, kStatNodeCalls), 0u);
+    return;
+  }
+  EXPECT_EQ(compiled.GetNodeStat(first, kStatNodeCalls), 4u);
+  EXPECT_EQ(compiled.GetNodeStat(first, kStatNodeScanned), 4u * 6);
+  // 先找到 age 之后的文本, 再取 age
+  EXPECT_EQ(compiled.GetNodeStat(last, kStatNodeCalls), 4u);
+  EXPECT_EQ(compiled.GetNodeStat(age, kStatNodeCalls), 3u);
+  EXPECT_EQ(compiled.GetNodeStat(age, kStatNodeFailure + kStatConvert), 1u);
+  EXPECT_EQ(compiled.GetNodeStat(last, kStatNodeFailure + kStatLiteralNotFound), 1u);
+  EXPECT_EQ(compiled.GetNodeStat(base, kStatNodeCalls), 2u);
+  EXPECT_EQ(compiled.GetNodeStat(base, kStatNodeFailure + kStatDeclFailed), 1u);
+
+  // 拷贝共用计数
+  CompiledFormat copy = compiled;
+  EXPECT_TRUE(copy.Match("Bob|20|UGFyaXM=", result));
+  EXPECT_EQ(compiled.GetNodeStat(age, kStatNodeCalls), 4u);
+  // 其他线程的计数, 包括已经退出的线程, 也会被汇总
+  std::thread([&] {
+    MatchResult local;
+    compiled.Match("Carol|30|UGFyaXM=", local);
+  }).join();
+  EXPECT_EQ(compiled.GetNodeStat(age, kStatNodeCalls), 5u);
+  ResetMatchStats();
+  EXPECT_EQ(compiled.GetNodeStat(age, kStatNodeCalls), 0u);
+  EXPECT_TRUE(compiled.Match("Dave|40|UGFyaXM=", result));
+  EXPECT_EQ(compiled.GetNodeStat(age, kStatNodeCalls), 1u);
+
+  // 定宽布局也按指令计数
+  CompiledFormat fixed;
+  ASSERT_EQ(parser.Parse("{id:int:04}|{code:02}", fixed), 0);
+  ASSERT_TRUE(fixed.IsFixedLayout());
+  EXPECT_FALSE(fixed.Match("  x1|US", result));
+  int id = find(fixed, kOpCapture, 1);
+  ASSERT_GE(id, 0);
+  EXPECT_EQ(fixed.GetNodeStat(id, kStatNodeCalls), 1u);
+  EXPECT_EQ(fixed.GetNodeStat(id, kStatNodeFailure + kStatConvert), 1u);
+}
+
+TEST(MatchStats, Tree)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  ASSERT_EQ(parser.Parse("[{name}]{Raw({age:int})}", root), 0);
+  ResetMatchStats();
+
+  MatchResult result;
+  EXPECT_TRUE(root.Handle("[Alice]18", 0, 9, result));
+  EXPECT_FALSE(root.Handle("x[Alice]18", 0, 10, result));
+  EXPECT_FALSE(root.Handle("[Alice]x", 0, 8, result));
+
+  MatchStats stats = GetMatchStats();
+  if (!kStatsEnabled) {
+    EXPECT_EQ(stats.Get(kStatHandles), 0u);
+    return;
+  }
+  EXPECT_EQ(stats.Get(kStatHandles), 5u);
+  EXPECT_EQ(stats.Get(kStatFailure + kStatNotAnchored), 1u);
+  EXPECT_EQ(stats.Get(kStatFailure + kStatConvert), 1u);
+  EXPECT_EQ(stats.Get(kStatDeclCalls + kStatDeclRaw), 2u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
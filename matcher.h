@@ -6,40 +6,182 @@
 // Date: 2022.03.14
 
 #pragma once
+#include <cstring>
+#include <deque>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stack>
 #include <set>
 #include <map>
 #include <memory>
+#include "base64.h"
+#include "field_type.h"
+#include "fkv.h"
+#include "literal_search.h"
 #include "tokenizer.h"
 
 namespace fq {
+class BacktrackFormat;
+class CompiledFormat;
+class FormatWriter;
+
+// 字段名到 slot 下标的映射, 在解析时确定, 同名字段共用一个 slot
+class NameTable {
+ public:
+  int Intern(std::string_view name) {
+    auto it = slots_.find(name);
+    if (it != slots_.end()) {
+      return it->second;
+    }
+    int slot = (int) names_.size();
+    names_.emplace_back(name);
+    slots_.emplace(std::string(name), slot);
+    return slot;
+  }
+
+  // 找不到返回 -1
+  int Find(std::string_view name) const {
+    auto it = slots_.find(name);
+    return it == slots_.end() ? -1 : it->second;
+  }
+
+  int Size() const { return (int) names_.size(); }
+  const std::string& GetName(int slot) const { return names_[slot]; }
+
+ private:
+  std::vector<std::string> names_;
+  std::map<std::string, int, std::less<>> slots_;
+};
+
+// 匹配结果只保存视图: name_/type_ 指向解析后的 format, value_ 指向被匹配的数据
+// 因此 MatchResult 不能比 format 和被匹配的数据活得更久, 需要独立保存时调用 Own()
 class ResultItem {
  public:
   ResultItem() = default;
-  ResultItem(std::string name, std::string type, std::string value)
+  ResultItem(std::string_view name, std::string_view type, std::string_view value)
       :name_(name), type_(type), value_(value) {}
+  ResultItem(std::string_view name, std::string_view type, std::string_view value, const FieldValue& typed)
+      :name_(name), type_(type), value_(value), typed_(typed) {}
 
 // private:
-  std::string name_, type_, value_;
+  std::string_view name_, type_, value_;
+  // 匹配时按 type 转换好的值
+  FieldValue typed_;
+  // 该 slot 在本次匹配中是否被设置
+  bool valid_ = false;
 };
 
+// 按 slot 下标保存结果的扁平数组
+// Reset() 只清除标记不释放内存, 同一个 MatchResult 可以反复用于匹配, 稳定后没有内存分配
 class MatchResult {
  public:
-  bool Set(std::string name, std::string type, std::string value) {
-    results_[name] = ResultItem(name, type, value);
+  MatchResult() = default;
+  explicit MatchResult(const NameTable* names) { Reset(names); }
+
+  // 绑定名字表后 Get(name) 通过名字表查找, 否则按 slot 顺序比较名字
+  void Reset(const NameTable* names) {
+    names_ = names;
+    Reset();
+    if (names_ != nullptr && (int) slots_.size() < names_->Size()) {
+      slots_.resize(names_->Size());
+    }
+  }
+
+  void Reset() {
+    for (auto& item: slots_) {
+      item.valid_ = false;
+    }
+    count_ = 0;
+    owned_.clear();
+    scratch_used_ = 0;
+  }
+
+  bool Set(int slot, std::string_view name, std::string_view type, std::string_view value,
+           const FieldValue& typed = FieldValue()) {
+    if (slot < 0) {
+      return false;
+    }
+    if (slot >= (int) slots_.size()) {
+      slots_.resize(slot + 1);
+    }
+    ResultItem& item = slots_[slot];
+    if (!item.valid_) {
+      ++count_;
+    }
+    item = ResultItem(name, type, value, typed);
+    item.valid_ = true;
     return true;
   }
 
+  const ResultItem* Get(int slot) const {
+    if (slot < 0 || slot >= (int) slots_.size() || !slots_[slot].valid_) {
+      return nullptr;
+    }
+    return &slots_[slot];
+  }
+
+  const ResultItem* Get(std::string_view name) const {
+    if (names_ != nullptr) {
+      return Get(names_->Find(name));
+    }
+    for (auto& item: slots_) {
+      if (item.valid_ && item.name_ == name) {
+        return &item;
+      }
+    }
+    return nullptr;
+  }
+
+  // 已设置的 slot 个数
+  int Size() const { return count_; }
+  // Reset 时绑定的名字表, 没有绑定为 nullptr
+  const NameTable* GetNameTable() const { return names_; }
+  // slot 数组的长度, 包括未设置的 slot
+  int Capacity() const { return (int) slots_.size(); }
+
+  // 供 Base64 等需要先转换数据的 decl 使用, 结果中的 value 可以指向其中
+  // 下次 Reset 之前有效, Reset 后内存被复用, 稳定后没有内存分配
+  std::string& AcquireScratch() {
+    if (scratch_used_ == scratch_.size()) {
+      scratch_.emplace_back();
+    }
+    return scratch_[scratch_used_++];
+  }
+
+  // 把所有 value 拷贝到 result 内部, 之后被匹配的数据可以释放
+  void Own() {
+    std::deque<std::string> owned;
+    for (auto& item: slots_) {
+      if (item.valid_) {
+        owned.emplace_back(item.value_);
+        item.value_ = owned.back();
+      }
+    }
+    owned_.swap(owned);
+  }
+
   void Dump() {
-    for (auto it: results_) {
-      printf("ResultItem '%s' '%s' '%s'\n", it.second.name_.c_str(), it.second.type_.c_str(), it.second.value_.c_str() );
+    for (auto& item: slots_) {
+      if (!item.valid_) {
+        continue;
+      }
+      printf("ResultItem '%.*s' '%.*s' '%.*s'\n",
+             (int) item.name_.size(), item.name_.data(),
+             (int) item.type_.size(), item.type_.data(),
+             (int) item.value_.size(), item.value_.data());
     }
   }
 
  private:
-  std::map<std::string, ResultItem> results_;
+  std::vector<ResultItem> slots_;
+  int count_ = 0;
+  const NameTable* names_ = nullptr;
+  // deque 保证 push_back 后元素地址不变
+  std::deque<std::string> owned_;
+  std::deque<std::string> scratch_;
+  size_t scratch_used_ = 0;
 };
 
 class FormatAstNode {
@@ -55,53 +197,98 @@ class FormatAstNode {
   virtual bool IsLiteral() {
     return false;
   }
-  virtual bool Search(std::string s, int start, int& match_start, int& match_stop) {
+  // 定宽字段的宽度, 不是定宽返回 0
+  virtual int GetWidth() const {
+    return 0;
+  }
+  virtual bool Search(std::string_view s, int start, int& match_start, int& match_stop) {
     return false;
   }
-  virtual bool Handle(std::string s, int start, int stop, MatchResult& result) {
+  virtual bool Handle(std::string_view s, int start, int stop, MatchResult& result) {
     return false;
   }
 };
 
 class FormatRootNode : public FormatAstNode {
  public:
-  bool Handle(std::string s, int start, int stop, MatchResult& result) override {
-    std::shared_ptr<FormatAstNode> pending;
-    for (auto element: elements_) {
+  explicit FormatRootNode(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : elements_(resource) {}
+
+  bool Handle(std::string_view s, int start, int stop, MatchResult& result) override {
+    FQ_STAT_ADD(kStatHandles, 1);
+    FormatAstNode* pending = nullptr;
+    // 紧跟在 pending 之后的定宽字段为 [fixed_begin, 当前 element), 总宽度为 fixed_width
+    // 它们的位置要等找到下一个文本或到达结尾时从后往前确定
+    size_t fixed_begin = 0;
+    int fixed_width    = 0;
+    for (size_t i = 0; i < elements_.size(); ++i) {
+      auto& element = elements_[i];
       if (element->IsLiteral()) {
         int match_start, match_stop;
         bool found = element->Search(s, start, match_start, match_stop);
         if (!found) {
+          FQ_STAT_ADD(kStatLiteralBytes, s.size() - start);
+          FQ_STAT_FAIL(kStatLiteralNotFound);
           return false;
         }
+        FQ_STAT_ADD(kStatLiteralBytes, match_stop - start);
         if (match_stop > stop) {
+          FQ_STAT_FAIL(kStatPastStop);
           return false;
         }
         if (pending) {
-          if (!pending->Handle(s, start, match_start, result)) {
+          if (!HandlePending(s, start, match_start, pending, fixed_begin, i, fixed_width, result)) {
             return false;
-          } else {
-            pending.reset();
           }
+          pending = nullptr;
         } else {
-          if (match_start != 0) {
+          if (match_start != start) {
+            FQ_STAT_FAIL(kStatNotAnchored);
             return false;
           }
         }
         start = match_stop;
       } else {
+        int width = element->GetWidth();
         if (pending) {
-          return false;
+          if (width == 0) {
+            FQ_STAT_FAIL(kStatAdjacent);
+            return false;
+          }
+          fixed_width += width;
+        } else if (width > 0) {
+          // 定宽字段按偏移切分, 之后的文本必须紧接着出现
+          if (stop - start < width) {
+            FQ_STAT_FAIL(kStatPastStop);
+            return false;
+          }
+          if (!element->Handle(s, start, start + width, result)) {
+            return false;
+          }
+          start += width;
         } else {
-          pending = element;
+          pending     = element.get();
+          fixed_begin = i + 1;
+          fixed_width = 0;
         }
       }
     }
     if (pending) {
-      return pending->Handle(s, start, stop, result);
+      return HandlePending(s, start, stop, pending, fixed_begin, elements_.size(), fixed_width, result);
     }
     return true;
   }
+
+  // 拷贝语义的封装: 结果不再引用 s, 调用方可以在 s 释放后继续使用 result
+  bool HandleCopy(const std::string& s, MatchResult& result) {
+    result.Reset(&names_);
+    if (!Handle(s, 0, (int) s.size(), result)) {
+      return false;
+    }
+    result.Own();
+    return true;
+  }
+
   void Append(std::shared_ptr<FormatAstNode> node) {
     elements_.push_back(node);
   }
@@ -110,6 +297,25 @@ class FormatRootNode : public FormatAstNode {
     return (int) elements_.size();
   }
 
+  const std::pmr::vector<std::shared_ptr<FormatAstNode>>& GetElements() const { return elements_; }
+
+  // 只有最外层的 root 有名字表, 由 FormatParser 填充
+  const NameTable& GetNameTable() const { return names_; }
+  NameTable* MutableNameTable() { return &names_; }
+
+  // 由 FormatParser 调用: 把 format 文本拷贝到 root 的 arena 中, 所有 Token 都是这份文本的视图
+  // arena 第一次使用时创建, size 为第一块内存的大小
+  std::string_view SaveText(std::string_view text, size_t size) {
+    if (!arena_) {
+      arena_ = std::make_shared<std::pmr::monotonic_buffer_resource>(size);
+    }
+    char* data = (char*) arena_->allocate(text.size() + 1, 1);
+    memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+  }
+  const std::shared_ptr<std::pmr::monotonic_buffer_resource>& GetArena() const { return arena_; }
+
+
   virtual void Dump(int d=0) override {
     std::string tap(d, ' ');
     printf("%sFormatRootNode() {\n", tap.c_str());
@@ -120,114 +326,198 @@ class FormatRootNode : public FormatAstNode {
     printf("%s}\n", tap.c_str());
   }
  private:
-  std::vector<std::shared_ptr<FormatAstNode>> elements_;
+  // [start, end) 依次分给 pending 和之后的定宽字段 [fixed_begin, fixed_end), 定宽字段占末尾 fixed_width 个字节
+  bool HandlePending(std::string_view s, int start, int end, FormatAstNode* pending, size_t fixed_begin,
+                     size_t fixed_end, int fixed_width, MatchResult& result) {
+    if (end - start < fixed_width) {
+      FQ_STAT_FAIL(kStatPastStop);
+      return false;
+    }
+    int pos = end - fixed_width;
+    if (!pending->Handle(s, start, pos, result)) {
+      return false;
+    }
+    for (size_t i = fixed_begin; i < fixed_end; ++i) {
+      int width = elements_[i]->GetWidth();
+      if (!elements_[i]->Handle(s, pos, pos + width, result)) {
+        return false;
+      }
+      pos += width;
+    }
+    return true;
+  }
+
+ private:
+  // arena 模式下 elements_ 中的节点也分配在 arena 中; 每个节点也持有 arena, 见 NodeAllocator
+  std::shared_ptr<std::pmr::monotonic_buffer_resource> arena_;
+  std::pmr::vector<std::shared_ptr<FormatAstNode>> elements_;
+  NameTable names_;
 };
 
 class FormatLiteralNode: public FormatAstNode {
  public:
-  FormatLiteralNode(Token token) : token_(token) {}
+  FormatLiteralNode(Token token) : token_(token), searcher_(token.GetString()) {}
 
   bool IsLiteral() override { return true; }
+  const Token& GetToken() const { return token_; }
   virtual void Dump(int d=0) override {
     std::string tap(d, ' ');
-    printf("%sFormatLiteralNode(Token(%s, %d, %d))\n",
-           tap.c_str(), token_.GetString().c_str(), token_.GetPos(), token_.GetType());
+    printf("%sFormatLiteralNode(Token(%.*s, %d, %d))\n", tap.c_str(),
+           (int) token_.GetString().size(), token_.GetString().data(), token_.GetPos(), token_.GetType());
   }
-  bool Search(std::string s, int start, int& match_start, int& match_stop) override {
-    auto pos = s.find(token_.GetString(), start);
-    if (pos == std::string::npos) {
+  bool Search(std::string_view s, int start, int& match_start, int& match_stop) override {
+    auto pos = searcher_.Find(s, start);
+    if (pos == LiteralSearcher::npos) {
       return false;
     }
     match_start = pos;
-    match_stop = pos + token_.GetString().size();
+    match_stop = pos + searcher_.Size();
     return true;
   }
  private:
   Token token_;
+  LiteralSearcher searcher_;
 };
 
+class FormatMatcherNode;
+
 class FormatDeclNode: public FormatAstNode {
  public:
+  explicit FormatDeclNode(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : elements_(resource) {}
+
   void SetName(Token token) { name_ = token; }
   bool HasName() { return !name_.IsEmpty(); }
   void AppendParam(std::shared_ptr<FormatRootNode> node) { elements_.push_back(node); }
 
+  // 参数解析完之后由 FormatParser 调用, 检查参数并构建 FKV 的 key 表
+  // FKV(pair_sep, kv_sep, {key}...): 分隔符只能是文本, key 只能是有名字的普通字段
+  // 返回 -12 参数不合法, -13 key 重复或超过 FkvIndex::kMaxKeys
+  int Finalize();
+
+  const Token& GetName() const { return name_; }
+  const std::pmr::vector<std::shared_ptr<FormatRootNode>>& GetParams() const { return elements_; }
+  const LiteralSearcher& GetPairSep() const { return pair_sep_; }
+  const LiteralSearcher& GetKvSep() const { return kv_sep_; }
+  const FkvIndex& GetFkvIndex() const { return fkv_; }
+  // 与 GetFkvIndex() 中 key 的下标一一对应
+  const std::vector<FormatMatcherNode*>& GetFkvFields() const { return fkv_fields_; }
+
   virtual void Dump(int d=0) override {
     std::string tap(d, ' ');
-    printf("%sFormatDeclNode(name=Token(%s, %d, %d)) {\n",
-           tap.c_str(), name_.GetString().c_str(), name_.GetPos(), name_.GetType());
+    printf("%sFormatDeclNode(name=Token(%.*s, %d, %d)) {\n", tap.c_str(),
+           (int) name_.GetString().size(), name_.GetString().data(), name_.GetPos(), name_.GetType());
     for (auto item: elements_) {
       item->Dump(d+2);
     }
     printf("%s}\n", tap.c_str());
   }
 
-  bool Handle(std::string s, int start, int stop, MatchResult& result) override {
+  bool Handle(std::string_view s, int start, int stop, MatchResult& result) override {
     if (!HasName()) {
+      FQ_STAT_FAIL(kStatDeclFailed);
       return false;
     }
 
+    [[maybe_unused]] uint64_t begin = FQ_STAT_NOW();
     auto func_name = name_.GetString();
     if (func_name == "Raw") {
       if (elements_.size() != 1) {
+        FQ_STAT_FAIL(kStatDeclFailed);
         return false;
       }
       auto value = s.substr(start, stop-start);
-      return elements_.at(0)->Handle(value, 0, value.size(), result);
+      bool ok = elements_.at(0)->Handle(value, 0, (int) value.size(), result);
+      FQ_STAT_DECL(kStatDeclRaw, begin);
+      return ok;
     }
-/*
     if (func_name == "Base64") {
       if (elements_.size() != 1) {
+        FQ_STAT_FAIL(kStatDeclFailed);
+        return false;
+      }
+      std::string& value = result.AcquireScratch();
+      if (!DecodeBase64(s.substr(start, stop-start), value)) {
+        FQ_STAT_FAIL(kStatDeclFailed);
         return false;
       }
-      auto value = DecodeBase64(s.substr(start, stop-start));
-      return elements_.at(0)->Handle(value, 0, value.size(), result);
+      bool ok = elements_.at(0)->Handle(value, 0, (int) value.size(), result);
+      FQ_STAT_DECL(kStatDeclBase64, begin);
+      return ok;
     }
     if (func_name == "FKV") {
-      if (elements_.size() != 3) {
-        return false;
+      bool ok = HandleFkv(s.substr(start, stop-start), result);
+      FQ_STAT_DECL(kStatDeclFkv, begin);
+      if (!ok) {
+        FQ_STAT_FAIL(kStatDeclFailed);
       }
-      auto value = s.substr(start, stop-start);
-      FKVHandler
-    }*/
+      return ok;
+    }
+    FQ_STAT_FAIL(kStatDeclFailed);
     return false;
   }
 
+ private:
+  bool HandleFkv(std::string_view s, MatchResult& result);
 
  private:
   Token name_;
-  std::vector<std::shared_ptr<FormatRootNode>> elements_;
+  std::pmr::vector<std::shared_ptr<FormatRootNode>> elements_;
+
+  // FKV
+  LiteralSearcher pair_sep_, kv_sep_;
+  FkvIndex fkv_;
+  std::vector<FormatMatcherNode*> fkv_fields_;
 };
 
 class FormatMatcherNode: public FormatAstNode {
  public:
   FormatMatcherNode() = default;
   void SetName(Token token) { name_ = token; }
-  void SetType(Token token) { type_ = token; }
-  void SetSpec(Token token) { spec_ = token; }
+  void SetType(Token token) { type_ = token; field_type_ = ParseFieldType(token.GetString()); }
+  void SetSpec(Token token) { spec_ = token; width_ = ParseFieldWidth(token.GetString()); }
   void SetDecl(std::shared_ptr<FormatDeclNode> node) { decl_ = node; }
+  void SetSlot(int slot) { slot_ = slot; }
 
   bool HasName() { return !name_.IsEmpty(); }
   bool HasType() { return !type_.IsEmpty(); }
   bool HasSpec() { return !spec_.IsEmpty(); }
   bool HasDecl() { return bool(decl_); }
 
+  const Token& GetName() const { return name_; }
+  const Token& GetType() const { return type_; }
+  const Token& GetSpec() const { return spec_; }
+  FieldType GetFieldType() const { return field_type_; }
+  int GetWidth() const override { return width_; }
+  int GetSlot() const { return slot_; }
+  const std::shared_ptr<FormatDeclNode>& GetDecl() const { return decl_; }
+
   virtual void Dump(int d=0) override {
     std::string tap(d, ' ');
-    printf("%sFormatMatcherNode(name=%s, type=%s, spec=%s) {\n",
-           tap.c_str(), name_.GetString().c_str(), type_.GetString().c_str(), spec_.GetString().c_str());
+    auto name = name_.GetString(), type = type_.GetString(), spec = spec_.GetString();
+    printf("%sFormatMatcherNode(name=%.*s, type=%.*s, spec=%.*s) {\n", tap.c_str(),
+           (int) name.size(), name.data(), (int) type.size(), type.data(), (int) spec.size(), spec.data());
     if (decl_) {
       decl_->Dump(d + 2);
     }
     printf("%s}\n", tap.c_str());
   }
 
-  bool Handle(std::string s, int start, int stop, MatchResult& result) override {
+  bool Handle(std::string_view s, int start, int stop, MatchResult& result) override {
     if (!HasDecl()) {
       if (!HasName()) {
         return false;
       }
-      return result.Set(name_.GetString(), type_.GetString(), s.substr(start, stop-start));
+      auto value = s.substr(start, stop-start);
+      if (width_ > 0) {
+        value = TrimFixedField(field_type_, value);
+      }
+      FieldValue typed;
+      if (!ConvertField(field_type_, value, typed)) {
+        FQ_STAT_FAIL(kStatConvert);
+        return false;
+      }
+      return result.Set(slot_, name_.GetString(), type_.GetString(), value, typed);
     } else {
       return decl_->Handle(s, start, stop, result);
     }
@@ -236,25 +526,131 @@ class FormatMatcherNode: public FormatAstNode {
 
  private:
   Token name_, type_, spec_;
+  FieldType field_type_ = kFieldTypeStr;
+  // 由 spec 决定, 0 表示不定宽
+  int width_ = 0;
+  // 结果中的下标, 由 FormatParser 分配
+  int slot_ = -1;
   std::shared_ptr<FormatDeclNode> decl_;
 };
 
+inline int FormatDeclNode::Finalize() {
+  if (name_.GetString() != "FKV") {
+    return 0;
+  }
+  if (elements_.size() != 3) {
+    return -12;
+  }
+  std::string seps[2];
+  for (int i = 0; i < 2; ++i) {
+    for (auto& element: elements_[i]->GetElements()) {
+      if (!element->IsLiteral()) {
+        return -12;
+      }
+      seps[i] += static_cast<FormatLiteralNode*>(element.get())->GetToken().GetString();
+    }
+    if (seps[i].empty()) {
+      return -12;
+    }
+  }
+  pair_sep_ = LiteralSearcher(seps[0]);
+  kv_sep_   = LiteralSearcher(seps[1]);
+
+  fkv_ = FkvIndex();
+  fkv_fields_.clear();
+  for (auto& element: elements_[2]->GetElements()) {
+    // key 之间的文本没有意义, 忽略
+    if (element->IsLiteral()) {
+      continue;
+    }
+    auto matcher = dynamic_cast<FormatMatcherNode*>(element.get());
+    if (matcher == nullptr || matcher->HasDecl() || !matcher->HasName()) {
+      return -12;
+    }
+    if (fkv_.Add(matcher->GetName().GetString()) < 0) {
+      return -13;
+    }
+    fkv_fields_.push_back(matcher);
+  }
+  if (fkv_fields_.empty()) {
+    return -12;
+  }
+  fkv_.Build();
+  return 0;
+}
+
+// 只扫描一遍, 需要的 key 都找到后不再看剩余部分, 也不保存不需要的 key
+inline bool FormatDeclNode::HandleFkv(std::string_view s, MatchResult& result) {
+  if (fkv_fields_.empty()) {
+    return false;
+  }
+  return ScanFkv(s, pair_sep_, kv_sep_, fkv_, [&](int key, std::string_view value) {
+    return fkv_fields_[key]->Handle(value, 0, (int) value.size(), result);
+  });
+}
+
+// FormatParser 创建节点使用的分配器: 从 resource 分配, 同时持有 root 的 arena
+// Token 指向 arena 中的 format 文本, arena 模式下节点和 shared_ptr 的控制块也在其中,
+// 控制块保存着分配器, 所以从 GetElements()/GetDecl()/GetParams() 拷贝出来的节点可以比 root 活得更久
+template <class T>
+class NodeAllocator {
+ public:
+  using value_type = T;
+
+  NodeAllocator(std::shared_ptr<std::pmr::monotonic_buffer_resource> arena, std::pmr::memory_resource* resource)
+      : arena_(std::move(arena)), resource_(resource) {}
+  template <class U>
+  NodeAllocator(const NodeAllocator<U>& other) : arena_(other.arena_), resource_(other.resource_) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T* p, size_t n) { resource_->deallocate(p, n * sizeof(T), alignof(T)); }
+
+  template <class U>
+  bool operator==(const NodeAllocator<U>& other) const { return resource_ == other.resource_; }
+  template <class U>
+  bool operator!=(const NodeAllocator<U>& other) const { return resource_ != other.resource_; }
+
+ private:
+  template <class U>
+  friend class NodeAllocator;
+
+  std::shared_ptr<std::pmr::monotonic_buffer_resource> arena_;
+  std::pmr::memory_resource* resource_;
+};
+
 class FormatParser {
  public:
-  FormatParser(bool debug=false) : debug_(debug) {}
+  // arena 为 true 时节点和参数数组都分配在 root 的 arena 中, 最后一个节点释放时一次释放
+  // 否则每个节点单独分配; 两种模式下 Token 都指向 root 保存的 format 文本
+  FormatParser(bool debug=false, bool arena=false) : debug_(debug), arena_(arena) {}
 
   int Parse(const std::string& str, FormatRootNode& root) {
-
-    Tokenizer tokenizer(str, debug_);
-    return ParseElements(tokenizer, root);
+    // 每个字段大约产生几个节点, 按 format 长度估计 arena 的大小
+    auto text = root.SaveText(str, arena_ ? 512 + str.size() * 32 : str.size() + 1);
+    root_arena_ = root.GetArena();
+    resource_   = arena_ ? root_arena_.get() : std::pmr::new_delete_resource();
+    Tokenizer tokenizer(text, debug_);
+    names_ = root.MutableNameTable();
+    int ret = ParseElements(tokenizer, root);
+    names_ = nullptr;
+    resource_ = nullptr;
+    root_arena_.reset();
+    return ret;
   }
 
+  // 解析并编译为扁平的指令序列, 定义见 compiled_format.cc
+  int Parse(const std::string& str, CompiledFormat& compiled);
+  // 解析为带回溯语义的 format, 字段默认为 kPolicyLazy, 定义见 backtrack_format.cc
+  int Parse(const std::string& str, BacktrackFormat& format);
+  // 解析为按 format 输出的 writer, 定义见 format_writer.cc
+  int Parse(const std::string& str, FormatWriter& writer);
+
   int ParseElements(Tokenizer& tokenizer, FormatRootNode& root) {
     while (tokenizer.HasNext()) {
       auto token = tokenizer.GetNext();
 
       if (token.GetType() == kTokenTypeLiteral) {
-        std::shared_ptr<FormatAstNode> node(new FormatLiteralNode(token));
+        std::shared_ptr<FormatAstNode> node = NewNode<FormatLiteralNode>(token);
         root.Append(node);
       } else if (token.GetType() == kTokenTypeEOF) {
         return 0;
@@ -262,7 +658,7 @@ class FormatParser {
         // 不应该走到这里 报错
         return -1;
       } else if (token.GetString() == "{") {
-        std::shared_ptr<FormatMatcherNode> node(new FormatMatcherNode());
+        std::shared_ptr<FormatMatcherNode> node = NewNode<FormatMatcherNode>();
         root.Append(node);
         int ret = ParseMatch(tokenizer, node);
         if (ret != 0) {
@@ -293,16 +689,23 @@ class FormatParser {
           return -3;
         }
         if (second_token.GetString() == "}") {
+          if (names_ != nullptr && matcher->HasName()) {
+            matcher->SetSlot(names_->Intern(matcher->GetName().GetString()));
+          }
           return 0;
         }
       } else if (second_token.GetString() == "(") {
-        std::shared_ptr<FormatDeclNode> node(new FormatDeclNode());
+        std::shared_ptr<FormatDeclNode> node = NewNode<FormatDeclNode>(resource_);
         node->SetName(first_token);
         matcher->SetDecl(node);
         int ret = ParseParamsList(tokenizer, node);
         if (ret != 0) {
           return ret;
         }
+        ret = node->Finalize();
+        if (ret != 0) {
+          return ret;
+        }
         auto end = tokenizer.GetNext();
         if (end.GetString() != "}") {
           return -9;
@@ -317,7 +720,7 @@ class FormatParser {
 
   int ParseParamsList(Tokenizer& tokenizer, std::shared_ptr<FormatDeclNode> decl) {
     while (tokenizer.HasNext()) {
-      std::shared_ptr<FormatRootNode> node(new FormatRootNode());
+      std::shared_ptr<FormatRootNode> node = NewNode<FormatRootNode>(resource_);
       int ret = ParseDeclParam(tokenizer, node);
       if (ret != 0) {
         return ret;
@@ -337,7 +740,7 @@ class FormatParser {
       auto token = tokenizer.GetNext();
 
       if (token.GetType() == kTokenTypeLiteral) {
-        std::shared_ptr<FormatAstNode> node(new FormatLiteralNode(token));
+        std::shared_ptr<FormatAstNode> node = NewNode<FormatLiteralNode>(token);
         root->Append(node);
       } else if (token.GetType() == kTokenTypeEOF) {
         return -6;
@@ -345,7 +748,7 @@ class FormatParser {
         // 不应该走到这里 报错
         return -7;
       } else if (token.GetString() == "{") {
-        std::shared_ptr<FormatMatcherNode> node(new FormatMatcherNode());
+        std::shared_ptr<FormatMatcherNode> node = NewNode<FormatMatcherNode>();
         root->Append(node);
         int ret = ParseMatch(tokenizer, node);
         if (ret != 0) {
@@ -355,7 +758,7 @@ class FormatParser {
         if (root->GetElementsSize() == 0) {
           ignore_comma = true;
         } else {
-          std::shared_ptr<FormatLiteralNode> node(new FormatLiteralNode(token));
+          std::shared_ptr<FormatLiteralNode> node = NewNode<FormatLiteralNode>(token);
           root->Append(node);
         }
       } else if (token.GetString() == ")") {
@@ -366,7 +769,7 @@ class FormatParser {
         }
       } else if (token.GetString() == ",") {
         if (ignore_comma) {
-          std::shared_ptr<FormatLiteralNode> node(new FormatLiteralNode(token));
+          std::shared_ptr<FormatLiteralNode> node = NewNode<FormatLiteralNode>(token);
           root->Append(node);
         } else {
           return 0;
@@ -380,8 +783,21 @@ class FormatParser {
     return 0;
   }
 
+ private:
+  // 节点与 shared_ptr 的控制块一起分配
+  template <class T, class... Args>
+  std::shared_ptr<T> NewNode(Args&&... args) {
+    return std::allocate_shared<T>(NodeAllocator<T>(root_arena_, resource_), std::forward<Args>(args)...);
+  }
+
  private:
   bool debug_ = false;
+  bool arena_ = false;
+  // 正在解析的 format 的节点使用的内存, 以及保存 format 文本的 arena
+  std::pmr::memory_resource* resource_ = nullptr;
+  std::shared_ptr<std::pmr::monotonic_buffer_resource> root_arena_;
+  // 正在解析的 format 的名字表
+  NameTable* names_ = nullptr;
 };
 
 }
\ No newline at end of file
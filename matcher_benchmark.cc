@@ -0,0 +1,554 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.30
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <map>
+#include <vector>
+#include "column_batch.h"
+#include "compile.h"
+#include "compiled_format.h"
+#include "format_cache.h"
+#include "format_set.h"
+#include "format_writer.h"
+#include "match_lines.h"
+#include "output_writer.h"
+#include "parallel_matcher.h"
+#include "stream_matcher.h"
+
+using namespace fq;
+
+// 与 sscanf/istringstream/std::regex 对比的几类典型数据
+//   0 pipe: 竖线分隔的访问日志
+//   1 kv:   key=value
+//   2 raw:  嵌套 Raw(...)
+//   3 long: 带 4KB 字段的长行, 字段之后还有 ';', 每种方法都必须扫描整个字段
+enum Dataset {
+  kPipe = 0,
+  kKeyValue = 1,
+  kRaw = 2,
+  kLong = 3,
+};
+
+static const char* kFormats[] = {
+  "{time}|{method}|{url}|{status:int}|{size:int}|{agent}",
+  "user={user} ip={ip} cost={cost:int}",
+  "{time}|{Raw({user}/{cost:int})}|{status:int}",
+  "{time}|{method}|{url}|{status:int}|{size:int}|{agent};",
+};
+
+static const char* kLabels[] = {"pipe", "kv", "raw", "long"};
+
+static const std::vector<std::string>& Lines(int dataset) {
+  static std::vector<std::string> lines[4];
+  auto& out = lines[dataset];
+  if (!out.empty()) {
+    return out;
+  }
+  std::string agent(4000, 'a');
+  for (int i = 0; i < 1000; ++i) {
+    auto id = std::to_string(i);
+    switch (dataset) {
+      case kPipe:
+        out.push_back("2022-04-04 12:00:00|GET|/index.html?id=" + id + "|200|" + id + "|Mozilla/5.0");
+        break;
+      case kKeyValue:
+        out.push_back("user=user" + id + " ip=10.0.0." + std::to_string(i % 256) + " cost=" + id);
+        break;
+      case kRaw:
+        out.push_back("2022-04-04 12:00:00|user" + id + "/" + id + "|200");
+        break;
+      case kLong:
+        out.push_back("2022-04-04 12:00:00|GET|/index.html?id=" + id + "|200|" + id + "|" + agent + ";");
+        break;
+    }
+  }
+  return out;
+}
+
+static void SetCounters(benchmark::State& state, int dataset) {
+  size_t bytes = 0;
+  for (auto& line : Lines(dataset)) {
+    bytes += line.size();
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * Lines(dataset).size());
+  state.SetBytesProcessed(int64_t(state.iterations()) * bytes);
+  state.SetLabel(kLabels[dataset]);
+}
+
+// 第二个参数为 1 时使用 arena
+static void BM_Parse(benchmark::State& state) {
+  int dataset = state.range(0);
+  std::string format = kFormats[dataset];
+  for (auto _ : state) {
+    FormatParser parser(false, state.range(1) != 0);
+    CompiledFormat compiled;
+    benchmark::DoNotOptimize(parser.Parse(format, compiled));
+  }
+  state.SetLabel(kLabels[dataset]);
+}
+BENCHMARK(BM_Parse)->ArgsProduct({{kPipe, kKeyValue, kRaw, kLong}, {0, 1}});
+
+static void BM_ParseTree(benchmark::State& state) {
+  int dataset = state.range(0);
+  std::string format = kFormats[dataset];
+  for (auto _ : state) {
+    FormatParser parser(false, state.range(1) != 0);
+    FormatRootNode root;
+    benchmark::DoNotOptimize(parser.Parse(format, root));
+  }
+  state.SetLabel(kLabels[dataset]);
+}
+BENCHMARK(BM_ParseTree)->ArgsProduct({{kPipe, kKeyValue, kRaw, kLong}, {0, 1}});
+
+static void BM_FqTree(benchmark::State& state) {
+  int dataset = state.range(0);
+  FormatParser parser;
+  FormatRootNode root;
+  parser.Parse(kFormats[dataset], root);
+  MatchResult result;
+  for (auto _ : state) {
+    for (auto& line : Lines(dataset)) {
+      result.Reset();
+      benchmark::DoNotOptimize(root.Handle(line, 0, line.size(), result));
+    }
+  }
+  SetCounters(state, dataset);
+}
+BENCHMARK(BM_FqTree)->DenseRange(0, 3);
+
+static void BM_FqCompiled(benchmark::State& state) {
+  int dataset = state.range(0);
+  FormatParser parser;
+  CompiledFormat compiled;
+  parser.Parse(kFormats[dataset], compiled);
+  MatchResult result;
+  for (auto _ : state) {
+    for (auto& line : Lines(dataset)) {
+      benchmark::DoNotOptimize(compiled.Match(line, result));
+    }
+  }
+  SetCounters(state, dataset);
+}
+BENCHMARK(BM_FqCompiled)->DenseRange(0, 3);
+
+// 每次请求都带着 format 文本, 命中缓存时不再解析
+static void BM_FormatCache(benchmark::State& state) {
+  std::string format = kFormats[kPipe];
+  auto& line = Lines(kPipe)[0];
+  MatchResult result;
+  for (auto _ : state) {
+    std::shared_ptr<const CompiledFormat> compiled;
+    FormatCache::Instance().Get(format, compiled);
+    benchmark::DoNotOptimize(compiled->Match(line, result));
+  }
+}
+BENCHMARK(BM_FormatCache)->ThreadRange(1, 8);
+
+// 15 个字段中取全部 / 取 2 个 / 取 2 个且不检查整行
+static void BM_Projection(benchmark::State& state) {
+  FormatParser parser;
+  CompiledFormat compiled;
+  parser.Parse("{ip} {ident} {user} [{time}] {method} {url} {proto} {status:int} {size:int} {referer} "
+               "{Raw({os}/{browser})} {cost:int} {upstream} {host} {trace}",
+               compiled);
+  std::string line = "10.0.0.1 - alice [30/Mar/2022:12:00:00] GET /index.html HTTP/1.1 200 5120 "
+                     "https://example.com/ linux/firefox 23 10.0.1.2:8080 example.com 4bf92f3577b34da6";
+  Projection projection;
+  std::vector<std::string> all;
+  for (int slot = 0; slot < compiled.GetNameTable().Size(); ++slot) {
+    all.push_back(compiled.GetNameTable().GetName(slot));
+  }
+  switch (state.range(0)) {
+    case 0:
+      compiled.Project(all, true, projection);
+      break;
+    case 1:
+      compiled.Project({"user", "status"}, true, projection);
+      break;
+    default:
+      compiled.Project({"user", "status"}, false, projection);
+      break;
+  }
+  MatchResult result;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(compiled.Match(line, projection, result));
+  }
+  state.SetLabel(state.range(0) == 0 ? "all" : state.range(0) == 1 ? "2 fields" : "2 fields, no validate");
+}
+BENCHMARK(BM_Projection)->DenseRange(0, 2);
+
+template <class Format>
+static void RunStatic(benchmark::State& state, int dataset, Format format) {
+  typename Format::Fields fields;
+  typename Format::Values values;
+  for (auto _ : state) {
+    for (auto& line : Lines(dataset)) {
+      benchmark::DoNotOptimize(format.Match(line, fields, values));
+    }
+  }
+  SetCounters(state, dataset);
+}
+
+// FQ_COMPILE 不支持 decl, 没有 raw
+static void BM_FqStatic(benchmark::State& state) {
+  int dataset = state.range(0);
+  if (dataset == kKeyValue) {
+    RunStatic(state, dataset, FQ_COMPILE("user={user} ip={ip} cost={cost:int}"));
+  } else if (dataset == kLong) {
+    RunStatic(state, dataset, FQ_COMPILE("{time}|{method}|{url}|{status:int}|{size:int}|{agent};"));
+  } else {
+    RunStatic(state, dataset, FQ_COMPILE("{time}|{method}|{url}|{status:int}|{size:int}|{agent}"));
+  }
+}
+BENCHMARK(BM_FqStatic)->Arg(kPipe)->Arg(kKeyValue)->Arg(kLong);
+
+static void BM_Sscanf(benchmark::State& state) {
+  int dataset = state.range(0);
+  static char a[4096], b[4096], c[4096], d[4096];
+  int x, y;
+  for (auto _ : state) {
+    for (auto& line : Lines(dataset)) {
+      int n = 0;
+      switch (dataset) {
+        case kPipe:
+          n = sscanf(line.c_str(), "%4095[^|]|%4095[^|]|%4095[^|]|%d|%d|%4095[^\n]", a, b, c, &x, &y, d);
+          break;
+        case kLong:
+          n = sscanf(line.c_str(), "%4095[^|]|%4095[^|]|%4095[^|]|%d|%d|%4095[^;];", a, b, c, &x, &y, d);
+          break;
+        case kKeyValue:
+          n = sscanf(line.c_str(), "user=%4095s ip=%4095s cost=%d", a, b, &x);
+          break;
+        case kRaw:
+          n = sscanf(line.c_str(), "%4095[^|]|%4095[^/]/%d|%d", a, b, &x, &y);
+          break;
+      }
+      benchmark::DoNotOptimize(n);
+    }
+  }
+  SetCounters(state, dataset);
+}
+BENCHMARK(BM_Sscanf)->DenseRange(0, 3);
+
+static void BM_Istringstream(benchmark::State& state) {
+  int dataset = state.range(0);
+  std::string a, b, c, d;
+  int x = 0, y = 0;
+  for (auto _ : state) {
+    for (auto& line : Lines(dataset)) {
+      std::istringstream in(line);
+      switch (dataset) {
+        case kPipe:
+        case kLong:
+          std::getline(in, a, '|');
+          std::getline(in, b, '|');
+          std::getline(in, c, '|');
+          in >> x;
+          in.ignore(1);
+          in >> y;
+          in.ignore(1);
+          std::getline(in, d, dataset == kLong ? ';' : '\n');
+          break;
+        case kKeyValue:
+          in >> a >> b >> c;
+          x = std::stoi(c.substr(5));
+          break;
+        case kRaw:
+          std::getline(in, a, '|');
+          std::getline(in, b, '/');
+          in >> x;
+          in.ignore(1);
+          in >> y;
+          break;
+      }
+      benchmark::DoNotOptimize(x);
+      benchmark::DoNotOptimize(in.fail());
+    }
+  }
+  SetCounters(state, dataset);
+}
+BENCHMARK(BM_Istringstream)->DenseRange(0, 3);
+
+static void BM_Regex(benchmark::State& state) {
+  int dataset = state.range(0);
+  static const char* patterns[] = {
+    "([^|]*)\\|([^|]*)\\|([^|]*)\\|(\\d+)\\|(\\d+)\\|(.*)",
+    "user=(\\S+) ip=(\\S+) cost=(\\d+)",
+    "([^|]*)\\|([^/]*)/(\\d+)\\|(\\d+)",
+    "([^|]*)\\|([^|]*)\\|([^|]*)\\|(\\d+)\\|(\\d+)\\|([^;]*);",
+  };
+  std::regex re(patterns[dataset]);
+  std::smatch match;
+  for (auto _ : state) {
+    for (auto& line : Lines(dataset)) {
+      benchmark::DoNotOptimize(std::regex_match(line, match, re));
+    }
+  }
+  SetCounters(state, dataset);
+}
+BENCHMARK(BM_Regex)->DenseRange(0, 3);
+
+// 60 个 key 的查询串中取 4 个
+static void BM_Fkv(benchmark::State& state) {
+  FormatParser parser;
+  CompiledFormat compiled;
+  parser.Parse("{path}?{FKV(&,=,{uid:int}{k7}{k31}{k50})}", compiled);
+  std::string line = "/search";
+  for (int i = 0; i < 60; ++i) {
+    line += (i == 0 ? "?k" : "&k") + std::to_string(i) + "=value" + std::to_string(i);
+  }
+  line += "&uid=10086";
+  MatchResult result;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(compiled.Match(line, result));
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * line.size());
+}
+BENCHMARK(BM_Fkv);
+
+// 同一行按定宽和按分隔符切分, 定宽只做偏移计算
+static void BM_FixedWidth(benchmark::State& state) {
+  FormatParser parser;
+  CompiledFormat compiled;
+  std::string line;
+  if (state.range(0) == 0) {
+    parser.Parse("{date:08}{time:06}{id:uint:10}{status:int:03}{size:int:08}{code:04}", compiled);
+    line = "202203301200000000010086200    51200000";
+  } else {
+    parser.Parse("{date}|{time}|{id:uint}|{status:int}|{size:int}|{code}", compiled);
+    line = "20220330|120000|0000010086|200|5120|0000";
+  }
+  MatchResult result;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(compiled.Match(line, result));
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * line.size());
+}
+BENCHMARK(BM_FixedWidth)->DenseRange(0, 1);
+
+// 95% 的行不匹配: 0 缺少后面的文本, 1 太短, 2 前缀不同
+static void BM_Prefilter(benchmark::State& state) {
+  FormatParser parser;
+  CompiledFormat compiled;
+  parser.Parse("{ip} - {user} [{time}] \"{method} {url} {proto}\" {status:int} {size:int}", compiled);
+  static const char* misses[] = {
+    "10.0.0.1 - alice 30/Mar/2022:12:00:00 GET /index.html?id=42 HTTP/1.1 200 5120 extra fields here",
+    "10.0.0.1 - -",
+    "10.0.0.1 - alice [30/Mar/2022:12:00:00] GET /index.html?id=42 HTTP/1.1 200 5120",
+  };
+  std::vector<std::string> lines;
+  for (int i = 0; i < 100; ++i) {
+    lines.push_back(i % 20 == 0 ? "10.0.0.1 - alice [30/Mar/2022:12:00:00] \"GET /index.html?id=42 HTTP/1.1\" 200 5120"
+                                : misses[state.range(0)]);
+  }
+  MatchResult result;
+  size_t bytes = 0;
+  for (auto& line : lines) {
+    bytes += line.size();
+  }
+  for (auto _ : state) {
+    for (auto& line : lines) {
+      benchmark::DoNotOptimize(compiled.Match(line, result));
+    }
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * bytes);
+  state.SetItemsProcessed(int64_t(state.iterations()) * lines.size());
+}
+BENCHMARK(BM_Prefilter)->DenseRange(0, 2);
+
+// 0 FormatWriter 写到 string, 1 FormatWriter 写到缓冲, 2 snprintf
+static void BM_FormatWriter(benchmark::State& state) {
+  FormatParser parser;
+  CompiledFormat compiled;
+  FormatWriter writer;
+  parser.Parse(kFormats[kPipe], compiled);
+  parser.Parse(kFormats[kPipe], writer);
+  const std::string& line = Lines(kPipe)[42];
+  MatchResult result;
+  compiled.Match(line, result);
+  std::string_view values[6];
+  for (int i = 0; i < 6; ++i) {
+    values[i] = result.Get(i)->value_;
+  }
+  std::string out;
+  char buf[256];
+  size_t written = 0;
+  for (auto _ : state) {
+    if (state.range(0) == 0) {
+      out.clear();
+      writer.Write(result, out);
+      written = out.size();
+    } else if (state.range(0) == 1) {
+      writer.Write(result, buf, sizeof(buf), &written);
+    } else {
+      written = snprintf(buf, sizeof(buf), "%.*s|%.*s|%.*s|%d|%d|%.*s", (int) values[0].size(), values[0].data(),
+                         (int) values[1].size(), values[1].data(), (int) values[2].size(), values[2].data(),
+                         (int) result.Get(3)->typed_.i, (int) result.Get(4)->typed_.i, (int) values[5].size(),
+                         values[5].data());
+    }
+    benchmark::DoNotOptimize(buf);
+    benchmark::DoNotOptimize(written);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * written);
+}
+BENCHMARK(BM_FormatWriter)->DenseRange(0, 2);
+
+static std::string MakePipeLines(size_t bytes) {
+  std::string buffer;
+  buffer.reserve(bytes + 128);
+  for (int i = 0; buffer.size() < bytes; ++i) {
+    buffer += "2022-03-30 12:00:00|GET|/index.html?id=" + std::to_string(i) + "|200|" +
+              std::to_string(i % 9973) + "|Mozilla/5.0 (X11; Linux x86_64)\n";
+  }
+  return buffer;
+}
+
+static const char* kPipeFormat = "{time}|{method}|{url}|{status:int}|{size:int}|{agent}";
+
+// 线程数从 1 增加到 32, 观察吞吐的扩展曲线
+static void BM_MatchParallel(benchmark::State& state) {
+  static const std::string buffer = MakePipeLines(64 << 20);
+  FormatParser parser;
+  CompiledFormat format;
+  parser.Parse(kPipeFormat, format);
+
+  ParallelOptions options;
+  options.threads    = state.range(0);
+  options.chunk_size = 1 << 20;
+  for (auto _ : state) {
+    size_t bytes   = 0;
+    size_t matched = MatchParallel(format, buffer, options, AppendTsvRecord,
+                                   [&](std::string_view out) { bytes += out.size(); });
+    benchmark::DoNotOptimize(matched);
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * buffer.size());
+}
+BENCHMARK(BM_MatchParallel)->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// 0: 每个字段一次 fprintf, 1: tsv, 2: jsonl, 3: csv
+static void BM_OutputFormat(benchmark::State& state) {
+  static const std::string buffer = MakePipeLines(4 << 20);
+  FormatParser parser;
+  CompiledFormat format;
+  parser.Parse(kPipeFormat, format);
+  static const RecordAppender appenders[] = {nullptr, AppendTsvRecord, AppendJsonRecord, AppendCsvRecord};
+  RecordAppender append = appenders[state.range(0)];
+  FILE* null = fopen("/dev/null", "w");
+  std::string out;
+  MatchResult result;
+  for (auto _ : state) {
+    MatchLines(format, buffer, result, [&](std::string_view, bool matched, const MatchResult& result) {
+      if (!matched) {
+        return;
+      }
+      if (append == nullptr) {
+        for (int slot = 0; slot < result.Capacity(); ++slot) {
+          auto item = result.Get(slot);
+          fprintf(null, "%.*s : %.*s\n", (int) item->name_.size(), item->name_.data(), (int) item->value_.size(),
+                  item->value_.data());
+        }
+        return;
+      }
+      append(result, out);
+      if (out.size() >= (1 << 20)) {
+        fwrite(out.data(), 1, out.size(), null);
+        out.clear();
+      }
+    });
+  }
+  fclose(null);
+  state.SetBytesProcessed(int64_t(state.iterations()) * buffer.size());
+}
+BENCHMARK(BM_OutputFormat)->DenseRange(0, 3)->Unit(benchmark::kMillisecond);
+
+// 0: 每行拷贝成一个 map, 1: 写入 ColumnBatch
+static void BM_MatchColumns(benchmark::State& state) {
+  static const std::string buffer = MakePipeLines(4 << 20);
+  FormatParser parser;
+  CompiledFormat format;
+  parser.Parse(kPipeFormat, format);
+  ColumnBatch batch(format);
+  for (auto _ : state) {
+    if (state.range(0) == 0) {
+      std::vector<std::map<std::string, std::string>> rows;
+      MatchResult result;
+      MatchLines(format, buffer, result, [&](std::string_view, bool matched, const MatchResult& result) {
+        auto& row = rows.emplace_back();
+        for (int slot = 0; matched && slot < result.Capacity(); ++slot) {
+          row.emplace(result.Get(slot)->name_, result.Get(slot)->value_);
+        }
+      });
+      benchmark::DoNotOptimize(rows.data());
+    } else {
+      batch.Clear();
+      benchmark::DoNotOptimize(MatchColumns(format, buffer, batch));
+    }
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * buffer.size());
+}
+BENCHMARK(BM_MatchColumns)->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+
+// 按 range(0) 字节切块喂给 StreamMatcher, 与整块 MatchLines 对比
+static void BM_StreamMatcher(benchmark::State& state) {
+  static const std::string buffer = MakePipeLines(4 << 20);
+  FormatParser parser;
+  CompiledFormat format;
+  parser.Parse(kPipeFormat, format);
+  size_t chunk = state.range(0);
+  for (auto _ : state) {
+    StreamMatcher stream(format);
+    size_t matched = 0;
+    for (size_t pos = 0; pos < buffer.size(); pos += chunk) {
+      matched += stream.Feed(std::string_view(buffer).substr(pos, chunk), [](std::string_view, bool, const MatchResult&) {});
+    }
+    matched += stream.Finish([](std::string_view, bool, const MatchResult&) {});
+    benchmark::DoNotOptimize(matched);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * buffer.size());
+}
+BENCHMARK(BM_StreamMatcher)->Arg(1500)->Arg(16 << 10)->Arg(4 << 20)->Unit(benchmark::kMillisecond);
+
+// format 个数从 5 增加到 500, 每行的耗时应该基本不变
+static void BM_FormatSet(benchmark::State& state) {
+  int count = state.range(0);
+  FormatSet set;
+  for (int i = 0; i < count; ++i) {
+    auto id = std::to_string(i);
+    if (i % 2 == 0) {
+      set.Add("event" + id + " user={user} cost={cost:int}");
+    } else {
+      set.Add("{time} [module" + id + "] {msg}");
+    }
+  }
+  set.Build();
+
+  std::vector<std::string> lines;
+  for (int i = 0; i < 1000; ++i) {
+    int k = (i * 7919) % count;
+    auto id = std::to_string(k);
+    lines.push_back(k % 2 == 0 ? "event" + id + " user=alice cost=" + std::to_string(i)
+                               : "12:00:00 [module" + id + "] something happened");
+  }
+  MatchResult result;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (auto& line : lines) {
+      benchmark::DoNotOptimize(set.Match(line, result));
+      bytes += line.size();
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * lines.size());
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_FormatSet)->Arg(5)->Arg(50)->Arg(500);
+
+BENCHMARK_MAIN();
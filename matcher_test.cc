@@ -0,0 +1,655 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.16
+
+#include "matcher.h"
+#include "compile.h"
+#include "compiled_format.h"
+#include <gtest/gtest.h>
+
+using namespace fq;
+
+static std::string Value(const MatchResult& result, std::string_view name) {
+  auto item = result.Get(name);
+  if (item == nullptr) {
+    return "<null>";
+  }
+  return std::string(item->value_);
+}
+
+TEST(Matcher, HandleSimple)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("{name}|{age}", root), 0);
+
+  MatchResult result;
+  std::string_view source = "Alice|18";
+  EXPECT_TRUE(root.Handle(source, 0, source.size(), result));
+  EXPECT_EQ(Value(result, "name"), "Alice");
+  EXPECT_EQ(Value(result, "age"), "18");
+}
+
+TEST(Matcher, HandleLeadingLiteral)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("[{name}]", root), 0);
+
+  MatchResult result;
+  EXPECT_TRUE(root.Handle("[Alice]", 0, 7, result));
+  EXPECT_EQ(Value(result, "name"), "Alice");
+  EXPECT_FALSE(root.Handle("x[Alice]", 0, 8, result));
+}
+
+TEST(Matcher, HandleRaw)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("{name:str}:{Raw({age:int}|{sex})}", root), 0);
+
+  MatchResult result;
+  std::string_view source = "Alice:18|F";
+  EXPECT_TRUE(root.Handle(source, 0, source.size(), result));
+  EXPECT_EQ(Value(result, "name"), "Alice");
+  EXPECT_EQ(Value(result, "age"), "18");
+  EXPECT_EQ(Value(result, "sex"), "F");
+  EXPECT_EQ(result.Get("age")->type_, "int");
+}
+
+TEST(Matcher, HandleBase64)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("{name}:{Base64({age:int}|{sex})}", root), 0);
+
+  // "18|F"
+  MatchResult result;
+  std::string_view source = "Alice:MTh8Rg==";
+  EXPECT_TRUE(root.Handle(source, 0, source.size(), result));
+  EXPECT_EQ(Value(result, "name"), "Alice");
+  EXPECT_EQ(Value(result, "age"), "18");
+  EXPECT_EQ(Value(result, "sex"), "F");
+  EXPECT_EQ(result.Get("age")->typed_.i, 18);
+
+  result.Reset();
+  EXPECT_FALSE(root.Handle("Alice:MTh8R!==", 0, 14, result));
+}
+
+TEST(Matcher, HandleFkv)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("{name}|{FKV(&,=,{sex}{age:int})}|{tail}", root), 0);
+
+  MatchResult result;
+  std::string_view source = "Alice|a=1&sex=F&b=&age=18&sex=M&c|end";
+  EXPECT_TRUE(root.Handle(source, 0, source.size(), result));
+  EXPECT_EQ(Value(result, "name"), "Alice");
+  EXPECT_EQ(Value(result, "sex"), "F");
+  EXPECT_EQ(Value(result, "age"), "18");
+  EXPECT_EQ(Value(result, "tail"), "end");
+  EXPECT_EQ(Value(result, "a"), "<null>");
+
+  // 缺少 key
+  result.Reset();
+  EXPECT_FALSE(root.Handle("Alice|a=1&sex=F|end", 0, 19, result));
+
+  // 多字节分隔符
+  EXPECT_EQ(parser.Parse("{FKV(; ,: ,{b})}", root = FormatRootNode()), 0);
+  result.Reset();
+  EXPECT_TRUE(root.Handle("a: 1; b: 2; c: 3", 0, 16, result));
+  EXPECT_EQ(Value(result, "b"), "2");
+
+  FormatRootNode bad;
+  EXPECT_EQ(parser.Parse("{FKV(&,=)}", bad), -12);
+  EXPECT_EQ(parser.Parse("{FKV(&,{x},{a})}", bad), -12);
+  EXPECT_EQ(parser.Parse("{FKV(&,=,{Raw({a})})}", bad), -12);
+  EXPECT_EQ(parser.Parse("{FKV(&,=,{a}{a})}", bad), -13);
+}
+
+TEST(Matcher, ResultIsViewOfSource)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("{name}|{age}", root), 0);
+
+  std::string source = "Alice|18";
+  MatchResult result;
+  EXPECT_TRUE(root.Handle(source, 0, source.size(), result));
+  EXPECT_EQ(result.Get("name")->value_.data(), source.data());
+  EXPECT_EQ(result.Get("age")->value_.data(), source.data() + 6);
+}
+
+TEST(Matcher, HandleCopy)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("{name}|{age}", root), 0);
+
+  MatchResult result;
+  {
+    std::string source = "Alice|18";
+    EXPECT_TRUE(root.HandleCopy(source, result));
+    source.assign(source.size(), 'x');
+  }
+  EXPECT_EQ(Value(result, "name"), "Alice");
+  EXPECT_EQ(Value(result, "age"), "18");
+}
+
+TEST(CompiledFormat, MatchSameAsTree)
+{
+  struct Case {
+    const char* format;
+    const char* source;
+  } cases[] = {
+    {"{name}|{age}", "Alice|18"},
+    {"{name}|{age}|", "Alice|18"},
+    {"[{name}]", "[Alice]"},
+    {"[{name}]", "x[Alice]"},
+    {"{name:str}:{Raw({age:int}|{sex})}", "Alice:18|F"},
+    {"{name:str}:{Raw({age:int}|{sex})},", "Alice:18|F,tail"},
+    {"{name:str}:{Base64({age:int}|{sex})}", "Alice:MTh8Rg=="},
+    {"{name:str}:{Base64({age:int}|{sex})}", "Alice:MTh8Rg="},
+    {"{name}:{FKV(&,=,{sex}{age:int})}", "Alice:a=1&sex=F&b=2&age=18&c=3"},
+    {"{name}:{FKV(&,=,{sex}{age:int})}", "Alice:a=1&sex=F&b=2"},
+    {"{name}:{FKV(&,=,{sex}{age:int})}", "Alice:a=1&sex=F&age=x"},
+    {"{a}{b}", "ab"},
+    {"{Unknown({a})}", "ab"},
+  };
+  for (auto& c : cases) {
+    FormatParser parser;
+    FormatRootNode root;
+    CompiledFormat compiled;
+    ASSERT_EQ(parser.Parse(c.format, root), 0);
+    ASSERT_EQ(parser.Parse(c.format, compiled), 0);
+
+    std::string_view source = c.source;
+    MatchResult tree_result, compiled_result;
+    bool tree_ok = root.Handle(source, 0, source.size(), tree_result);
+    EXPECT_EQ(compiled.Match(source, compiled_result), tree_ok) << c.format << " " << c.source;
+    EXPECT_EQ(compiled_result.Size(), tree_result.Size()) << c.format;
+    for (auto name : {"name", "age", "sex"}) {
+      EXPECT_EQ(Value(compiled_result, name), Value(tree_result, name)) << c.format;
+    }
+  }
+}
+
+TEST(CompiledFormat, MatchProjection)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{ip}|{Raw({user}/{uid:int})}|{Base64({city}/{zip:int})}|{FKV(&,=,{k})}|{cost:int}|{agent}",
+                         compiled), 0);
+  Projection projection;
+  EXPECT_EQ(compiled.Project({"ip", "nope"}, true, projection), -1);
+
+  // "Paris/75000"
+  std::string line = "1.2.3.4|alice/7|UGFyaXMvNzUwMDA=|a=1&k=v|12|curl";
+  MatchResult full, result;
+  ASSERT_TRUE(compiled.Match(line, full));
+
+  for (bool validate : {true, false}) {
+    for (auto& wanted : std::vector<std::vector<std::string>>{{"ip"}, {"uid"}, {"zip", "k"}, {"cost"}, {"agent"}, {}}) {
+      ASSERT_EQ(compiled.Project(wanted, validate, projection), 0);
+      ASSERT_TRUE(compiled.Match(line, projection, result));
+      EXPECT_EQ(result.Size(), (int) wanted.size());
+      for (auto& name : wanted) {
+        EXPECT_EQ(Value(result, name), Value(full, name)) << name;
+        EXPECT_EQ(result.Get(name)->typed_.i, full.Get(name)->typed_.i) << name;
+      }
+    }
+  }
+
+  // 只有 validate 时才检查不需要的字段和后面的文本
+  std::string bad_cost = "1.2.3.4|alice/7|UGFyaXMvNzUwMDA=|a=1&k=v|x|curl";
+  ASSERT_EQ(compiled.Project({"ip"}, true, projection), 0);
+  EXPECT_FALSE(compiled.Match(bad_cost, projection, result));
+  ASSERT_EQ(compiled.Project({"ip"}, false, projection), 0);
+  EXPECT_TRUE(compiled.Match(bad_cost, projection, result));
+  EXPECT_EQ(Value(result, "ip"), "1.2.3.4");
+  ASSERT_EQ(compiled.Project({"agent"}, false, projection), 0);
+  EXPECT_TRUE(compiled.Match("1.2.3.4|alice/x|!!!!|a=1|x|curl", projection, result));
+  EXPECT_EQ(Value(result, "agent"), "curl");
+}
+
+TEST(CompiledFormat, Summary)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("[{time}] {id:int:04}{Raw({user}@{host})} {Base64({city}#{zip})}", compiled), 0);
+  const FormatSummary& summary = compiled.GetSummary();
+  EXPECT_EQ(summary.prefix, "[");
+  // "[" "] " 4 " ", Raw 中的 "@" 在行中但不重复计入长度
+  EXPECT_EQ(summary.min_length, 8);
+  EXPECT_EQ(summary.rare_byte, '@');
+  EXPECT_TRUE(summary.MayMatch("[t] 0001a@b Yw=="));
+  EXPECT_FALSE(summary.MayMatch("[t] 0001ab Yw=="));
+  EXPECT_FALSE(summary.MayMatch("t] 0001a@b Yw=="));
+  EXPECT_FALSE(summary.MayMatch("[t]0@"));
+
+  // 随机的行上与语法树的结果一致, 即预先过滤不会排除能匹配的行
+  const char* formats[] = {"{a}|{b:int}|", "[{a}]{b}", "{a}@{Raw({b}|{c})}#", "{a}:{Base64({b}|{c})}", "x{a:02}y{b}"};
+  const char alphabet[] = "|[]@#:xy0a";
+  srand(1);
+  for (auto format : formats) {
+    FormatRootNode root;
+    ASSERT_EQ(parser.Parse(format, root), 0);
+    ASSERT_EQ(parser.Parse(format, compiled), 0);
+    for (int i = 0; i < 20000; ++i) {
+      std::string line(rand() % 8, ' ');
+      for (auto& ch : line) {
+        ch = alphabet[rand() % (sizeof(alphabet) - 1)];
+      }
+      MatchResult tree_result, compiled_result;
+      ASSERT_EQ(compiled.Match(line, compiled_result), root.Handle(line, 0, line.size(), tree_result))
+          << format << " " << line;
+    }
+  }
+}
+
+TEST(CompiledFormat, Recompile)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("id={id:int:04}|", compiled), 0);
+  ASSERT_TRUE(compiled.IsFixedLayout());
+
+  // 失败时不保留上次编译的任何结果
+  std::string deep = "{a}";
+  for (int i = 0; i <= CompiledFormat::kMaxDeclDepth; ++i) {
+    deep = "{Raw(" + deep + ")}";
+  }
+  FormatRootNode root;
+  ASSERT_EQ(parser.Parse(deep, root), 0);
+  EXPECT_EQ(compiled.Compile(root), -20);
+  EXPECT_FALSE(compiled.IsFixedLayout());
+  EXPECT_EQ(compiled.GetPrefix(), "");
+  EXPECT_EQ(compiled.GetSummary().min_length, 0);
+  EXPECT_EQ(compiled.GetNameTable().Size(), 0);
+  MatchResult result;
+  EXPECT_FALSE(compiled.Match("id=0042|", result));
+  EXPECT_FALSE(compiled.Match("x", result));
+
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", compiled), 0);
+  EXPECT_FALSE(compiled.IsFixedLayout());
+  EXPECT_TRUE(compiled.Match("Alice|18", result));
+  EXPECT_EQ(Value(result, "age"), "18");
+}
+
+TEST(CompiledFormat, MatchFixedWidth)
+{
+  FormatParser parser;
+  CompiledFormat fixed;
+  ASSERT_EQ(parser.Parse("{id:int:04}{code:02}|{amount:float:08}", fixed), 0);
+  EXPECT_TRUE(fixed.IsFixedLayout());
+
+  MatchResult result;
+  ASSERT_TRUE(fixed.Match("0042US|  12.50 ", result));
+  EXPECT_EQ(result.Get("id")->typed_.i, 42);
+  EXPECT_EQ(Value(result, "code"), "US");
+  EXPECT_EQ(Value(result, "amount"), "12.50");
+  EXPECT_EQ(result.Get("amount")->typed_.f, 12.5);
+  EXPECT_FALSE(fixed.Match("0042US|  12.5", result));
+  EXPECT_FALSE(fixed.Match("0042US-  12.50 ", result));
+  EXPECT_FALSE(fixed.Match("00x2US|  12.50 ", result));
+
+  // 定宽和分隔符混用, 结果与语法树一致
+  struct Case {
+    const char* format;
+    const char* source;
+  } cases[] = {
+    {"{id:int:04}{code:02}|{amount:float:08}", "0042US|  12.50 tail"},
+    {"{id:int:04}{name}|{age:int}", "0042Alice|18"},
+    {"{name}|{id:int:04}{age:int}", "Alice|004218"},
+    {"{name}|{id:int:04}", "Alice|00"},
+    {"{name}{id:int:04}", "Alice0042"},
+    {"[{id:int:04}]{Raw({name}|{age:int:03})}", "[  42]Alice| 18"},
+  };
+  for (auto& c : cases) {
+    FormatRootNode root;
+    CompiledFormat compiled;
+    ASSERT_EQ(parser.Parse(c.format, root), 0);
+    ASSERT_EQ(parser.Parse(c.format, compiled), 0);
+
+    std::string_view source = c.source;
+    MatchResult tree_result, compiled_result;
+    bool tree_ok = root.Handle(source, 0, source.size(), tree_result);
+    EXPECT_EQ(compiled.Match(source, compiled_result), tree_ok) << c.format << " " << c.source;
+    for (auto name : {"id", "name", "age"}) {
+      EXPECT_EQ(Value(compiled_result, name), Value(tree_result, name)) << c.format;
+    }
+  }
+}
+
+TEST(CompiledFormat, PendingBeforeFixed)
+{
+  // 待处理字段之后的定宽字段从下一个文本开头或结尾往回数
+  struct Case {
+    const char* format;
+    const char* source;
+    bool ok;
+    const char* a;
+    const char* id;
+  } cases[] = {
+    {"{a}{id:int:03}", "xy 17", true, "xy", "17"},
+    {"{a}{id:int:03}", " 17", true, "", "17"},
+    {"{a}{id:int:03}", "17", false, "", ""},
+    {"{a}{id:int:03}|{b}", "xy 17|z", true, "xy", "17"},
+    {"{a}{id:int:03}|{b}", "x1|z", false, "", ""},
+    {"{a}{id:int:03}|{b}", "xy  x|z", false, "", ""},
+    {"{a}{id:int:03}{c:02}|{b}", "xy 17US|z", true, "xy", "17"},
+    {"[{Raw({a}{id:int:03})}]", "[ab 42]", true, "ab", "42"},
+    {"{a}{id:int:03}{b}", "xy 17z", false, "", ""},
+  };
+  FormatParser parser;
+  for (auto& c : cases) {
+    FormatRootNode root;
+    CompiledFormat compiled;
+    ASSERT_EQ(parser.Parse(c.format, root), 0);
+    ASSERT_EQ(parser.Parse(c.format, compiled), 0);
+
+    std::string_view source = c.source;
+    MatchResult tree_result, compiled_result;
+    EXPECT_EQ(root.Handle(source, 0, source.size(), tree_result), c.ok) << c.format << " " << c.source;
+    EXPECT_EQ(compiled.Match(source, compiled_result), c.ok) << c.format << " " << c.source;
+    if (!c.ok) {
+      continue;
+    }
+    EXPECT_EQ(Value(tree_result, "a"), c.a) << c.format;
+    EXPECT_EQ(Value(tree_result, "id"), c.id) << c.format;
+    for (auto name : {"a", "id", "b", "c"}) {
+      EXPECT_EQ(Value(compiled_result, name), Value(tree_result, name)) << c.format;
+    }
+  }
+}
+
+TEST(CompiledFormat, FixedWidthFkvKey)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  CompiledFormat compiled;
+  const char* format = "{path}?{FKV(&,=,{id:int:04}{name:06})}";
+  ASSERT_EQ(parser.Parse(format, root), 0);
+  ASSERT_EQ(parser.Parse(format, compiled), 0);
+  for (std::string_view source : {"/a?id=  42&name=Bob   ", "/a?name=x&id=0042", "/a?id= 4x &name=y"}) {
+    MatchResult tree_result, compiled_result;
+    bool ok = root.Handle(source, 0, source.size(), tree_result);
+    EXPECT_EQ(compiled.Match(source, compiled_result), ok) << source;
+    if (!ok) {
+      continue;
+    }
+    for (auto name : {"path", "id", "name"}) {
+      EXPECT_EQ(Value(compiled_result, name), Value(tree_result, name)) << source;
+    }
+    EXPECT_EQ(compiled_result.Get("id")->typed_.i, 42);
+  }
+}
+
+TEST(StaticFormat, Match)
+{
+  auto format = FQ_COMPILE("{name:str}|{age:int}");
+  using Format = decltype(format);
+  static_assert(Format::kFieldCount == 2, "");
+  static_assert(Format::FieldName(1) == "age", "");
+  static_assert(Format::FieldTypeName(1) == "int", "");
+
+  Format::Fields fields;
+  EXPECT_TRUE(format.Match("Alice|18", fields));
+  EXPECT_EQ(fields[0], "Alice");
+  EXPECT_EQ(fields[1], "18");
+  EXPECT_FALSE(format.Match("Alice-18", fields));
+
+  MatchResult result;
+  EXPECT_TRUE(format.Match("Bob|20", result));
+  EXPECT_EQ(Value(result, "name"), "Bob");
+  EXPECT_EQ(result.Get("age")->type_, "int");
+}
+
+TEST(StaticFormat, White)
+{
+  // 字段名前后的空白与运行期解析一样被忽略
+  auto spaced  = FQ_COMPILE("{ name }|{age :int}|{ id : int :04 }");
+  using Spaced = decltype(spaced);
+  static_assert(Spaced::kFieldCount == 3, "");
+  static_assert(Spaced::FieldName(0) == "name", "");
+  static_assert(Spaced::FieldName(1) == "age", "");
+  static_assert(Spaced::FieldTypeName(1) == "int", "");
+  static_assert(Spaced::FieldTypeName(2) == "int", "");
+
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{ name }|{age :int}|{ id : int :04 }", compiled), 0);
+  MatchResult static_result, compiled_result;
+  ASSERT_TRUE(spaced.Match("Alice|18|  42", static_result));
+  ASSERT_TRUE(compiled.Match("Alice|18|  42", compiled_result));
+  for (auto name : {"name", "age", "id"}) {
+    EXPECT_EQ(Value(static_result, name), Value(compiled_result, name));
+  }
+}
+
+TEST(StaticFormat, SameName)
+{
+  auto format  = FQ_COMPILE("{a}|{b:int}|{a}");
+  using Format = decltype(format);
+  static_assert(Format::kSlots[0] == 0 && Format::kSlots[1] == 1 && Format::kSlots[2] == 0, "");
+  static_assert(Format::kNameCount == 2, "");
+
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{a}|{b:int}|{a}", compiled), 0);
+  for (auto name : {"a", "b"}) {
+    EXPECT_EQ(Format::GetNameTable().Find(name), compiled.GetSlot(name)) << name;
+  }
+
+  // 与 CompiledFormat 一样, 后出现的同名字段覆盖先出现的
+  MatchResult static_result, compiled_result;
+  ASSERT_TRUE(format.Match("x|1|y", static_result));
+  ASSERT_TRUE(compiled.Match("x|1|y", compiled_result));
+  EXPECT_EQ(static_result.Size(), compiled_result.Size());
+  EXPECT_EQ(Value(static_result, "a"), "y");
+  EXPECT_EQ(Value(compiled_result, "a"), "y");
+  EXPECT_EQ(static_result.Get(1)->name_, "b");
+}
+
+TEST(StaticFormat, MatchSameAsCompiled)
+{
+  auto format = FQ_COMPILE("[{time}] {level}: {msg}");
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("[{time}] {level}: {msg}", compiled), 0);
+
+  for (auto source : {"[12:00] INFO: hello: world", "12:00] INFO: x", "[12:00] INFO", ""}) {
+    MatchResult static_result, compiled_result;
+    bool ok = format.Match(source, static_result);
+    EXPECT_EQ(ok, compiled.Match(source, compiled_result)) << source;
+    if (!ok) {
+      continue;
+    }
+    for (auto name : {"time", "level", "msg"}) {
+      EXPECT_EQ(Value(static_result, name), Value(compiled_result, name)) << source;
+    }
+  }
+}
+
+TEST(StaticFormat, MatchFixedWidth)
+{
+  auto format = FQ_COMPILE("{id:int:04}{name}|{age:int:03}");
+  using Format = decltype(format);
+  Format::Fields fields;
+  Format::Values values;
+  EXPECT_TRUE(format.Match("0042Alice| 18", fields, values));
+  EXPECT_EQ(fields[0], "0042");
+  EXPECT_EQ(fields[1], "Alice");
+  EXPECT_EQ(fields[2], "18");
+  EXPECT_EQ(values[0].i, 42);
+  EXPECT_FALSE(format.Match("0042Alice|18", fields, values));
+  EXPECT_FALSE(format.Match("004", fields, values));
+}
+
+TEST(StaticFormat, PendingBeforeFixed)
+{
+  auto format = FQ_COMPILE("{a}{id:int:03}{c:02}|{b}{n:int:02}");
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{a}{id:int:03}{c:02}|{b}{n:int:02}", compiled), 0);
+
+  for (auto source : {"xy 17US|z 9", " 17US|42", "17US|z 9", "xy 17US|9", "xy 1xUS|z 9"}) {
+    MatchResult static_result, compiled_result;
+    bool ok = format.Match(source, static_result);
+    EXPECT_EQ(ok, compiled.Match(source, compiled_result)) << source;
+    if (!ok) {
+      continue;
+    }
+    for (auto name : {"a", "id", "c", "b", "n"}) {
+      EXPECT_EQ(Value(static_result, name), Value(compiled_result, name)) << source;
+    }
+  }
+  MatchResult result;
+  ASSERT_TRUE(format.Match("xy 17US|z 9", result));
+  EXPECT_EQ(Value(result, "a"), "xy");
+  EXPECT_EQ(Value(result, "c"), "US");
+  EXPECT_EQ(Value(result, "b"), "z");
+  EXPECT_EQ(Value(result, "n"), "9");
+}
+
+TEST(FieldType, Convert)
+{
+  FieldValue value;
+  EXPECT_TRUE(ConvertField(kFieldTypeInt, "-1234567890123", value));
+  EXPECT_EQ(value.i, -1234567890123);
+  EXPECT_TRUE(ConvertField(kFieldTypeInt, "-9223372036854775808", value));
+  EXPECT_EQ(value.i, INT64_MIN);
+  EXPECT_FALSE(ConvertField(kFieldTypeInt, "12a45678", value));
+  EXPECT_FALSE(ConvertField(kFieldTypeInt, "", value));
+  EXPECT_TRUE(ConvertField(kFieldTypeUint, "18446744073709551615", value));
+  EXPECT_EQ(value.u, UINT64_MAX);
+  EXPECT_FALSE(ConvertField(kFieldTypeUint, "18446744073709551616", value));
+  EXPECT_TRUE(ConvertField(kFieldTypeUint, "0000000012345678", value));
+  EXPECT_EQ(value.u, 12345678u);
+  EXPECT_TRUE(ConvertField(kFieldTypeFloat, "1.5e3", value));
+  EXPECT_EQ(value.f, 1500.0);
+  EXPECT_TRUE(ConvertField(kFieldTypeHex, "0xff", value));
+  EXPECT_EQ(value.u, 255u);
+  EXPECT_TRUE(ConvertField(kFieldTypeBool, "false", value));
+  EXPECT_FALSE(value.b);
+  EXPECT_FALSE(ConvertField(kFieldTypeBool, "yes", value));
+}
+
+TEST(Matcher, ParseArena)
+{
+  const char* format = "{name:str}:{Raw({age:int}|{sex})},{FKV(&,=,{k})}";
+  std::string_view source = "Alice:18|F,a=1&k=v";
+  MatchResult heap_result, arena_result;
+  FormatRootNode heap_root;
+  {
+    // format 文本在解析之后释放, 结果中的名字仍然有效
+    std::string text = format;
+    FormatParser heap_parser;
+    EXPECT_EQ(heap_parser.Parse(text, heap_root), 0);
+    text.assign(text.size(), 'x');
+  }
+  EXPECT_TRUE(heap_root.Handle(source, 0, source.size(), heap_result));
+
+  for (int i = 0; i < 3; ++i) {
+    FormatParser parser(false, true);
+    FormatRootNode root;
+    EXPECT_EQ(parser.Parse(format, root), 0);
+    ASSERT_NE(root.GetArena(), nullptr);
+    arena_result.Reset();
+    EXPECT_TRUE(root.Handle(source, 0, source.size(), arena_result));
+    for (auto name : {"name", "age", "sex", "k"}) {
+      EXPECT_EQ(Value(arena_result, name), Value(heap_result, name)) << name;
+    }
+    EXPECT_EQ(arena_result.Get("age")->name_, "age");
+    EXPECT_EQ(arena_result.Get("age")->type_, "int");
+  }
+}
+
+TEST(Matcher, NodeOutlivesRoot)
+{
+  // 两种模式下, 从 root 拷贝出来的节点在 root 析构后仍然可以使用
+  for (bool arena : {false, true}) {
+    std::shared_ptr<FormatAstNode> element;
+    std::shared_ptr<FormatRootNode> param;
+    {
+      FormatParser parser(false, arena);
+      FormatRootNode root;
+      ASSERT_EQ(parser.Parse("{name}:{Raw({age:int}|{sex})}", root), 0);
+      element = root.GetElements()[2];
+      auto matcher = std::dynamic_pointer_cast<FormatMatcherNode>(element);
+      ASSERT_NE(matcher, nullptr);
+      param = matcher->GetDecl()->GetParams()[0];
+    }
+    auto matcher = std::static_pointer_cast<FormatMatcherNode>(element);
+    EXPECT_EQ(matcher->GetDecl()->GetName().GetString(), "Raw");
+    ASSERT_EQ(param->GetElements().size(), 3u);
+    auto age = std::static_pointer_cast<FormatMatcherNode>(param->GetElements()[0]);
+    EXPECT_EQ(age->GetName().GetString(), "age");
+    element.reset();
+    EXPECT_EQ(std::static_pointer_cast<FormatLiteralNode>(param->GetElements()[1])->GetToken().GetString(), "|");
+  }
+}
+
+TEST(Matcher, HandleTyped)
+{
+  FormatParser parser;
+  FormatRootNode root;
+  CompiledFormat compiled;
+  const char* format = "{name:str}|{age:int}|{score:float}";
+  ASSERT_EQ(parser.Parse(format, root), 0);
+  ASSERT_EQ(parser.Parse(format, compiled), 0);
+  auto ct = FQ_COMPILE("{name:str}|{age:int}|{score:float}");
+
+  MatchResult tree_result, compiled_result, ct_result;
+  std::string_view source = "Alice|18|99.5";
+  EXPECT_TRUE(root.Handle(source, 0, source.size(), tree_result));
+  EXPECT_TRUE(compiled.Match(source, compiled_result));
+  EXPECT_TRUE(ct.Match(source, ct_result));
+  for (auto result : {&tree_result, &compiled_result, &ct_result}) {
+    EXPECT_EQ(result->Get("age")->typed_.type, kFieldTypeInt);
+    EXPECT_EQ(result->Get("age")->typed_.i, 18);
+    EXPECT_EQ(result->Get("score")->typed_.f, 99.5);
+  }
+
+  source = "Alice|eighteen|99.5";
+  EXPECT_FALSE(root.Handle(source, 0, source.size(), tree_result));
+  EXPECT_FALSE(compiled.Match(source, compiled_result));
+  EXPECT_FALSE(ct.Match(source, ct_result));
+}
+
+TEST(MatchResult, ReuseSlots)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}|{Raw({city}/{name})}", compiled), 0);
+  EXPECT_EQ(compiled.GetNameTable().Size(), 3);
+  EXPECT_EQ(compiled.GetSlot("name"), 0);
+  EXPECT_EQ(compiled.GetSlot("city"), 2);
+  EXPECT_EQ(compiled.GetSlot("unknown"), -1);
+
+  MatchResult result;
+  EXPECT_TRUE(compiled.Match("Alice|18|Paris/Bob", result));
+  EXPECT_EQ(result.Size(), 3);
+  EXPECT_EQ(result.Capacity(), 3);
+  EXPECT_EQ(Value(result, "name"), "Bob");
+  EXPECT_EQ(result.Get(compiled.GetSlot("city"))->value_, "Paris");
+
+  EXPECT_FALSE(compiled.Match("Carol|x|Rome/Dan", result));
+  EXPECT_EQ(result.Size(), 1);
+  EXPECT_EQ(result.Get("city"), nullptr);
+
+  EXPECT_TRUE(compiled.Match("Carol|20|Rome/Dan", result));
+  EXPECT_EQ(result.Size(), 3);
+  EXPECT_EQ(result.Capacity(), 3);
+  EXPECT_EQ(Value(result, "age"), "20");
+  EXPECT_EQ(Value(result, "name"), "Dan");
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
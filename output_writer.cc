@@ -0,0 +1,313 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.28
+
+#include "output_writer.h"
+#include <errno.h>
+#include <unistd.h>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define FQ_HAVE_SSE2 1
+#endif
+
+namespace fq {
+
+namespace {
+
+enum SpecialKind {
+  kSpecialJson = 0,  // 控制字符, '"', '\\'
+  kSpecialCsv  = 1,  // ',', '"', '\r', '\n'
+  kSpecialTsv  = 2,  // '\t', '\n', '\r', '\\'
+};
+
+// 除 JSON 的控制字符外每种格式 4 个需要特殊处理的字节, JSON 只有两个, 重复一次
+constexpr char kSpecialBytes[3][4] = {
+  {'"', '\\', '"', '\\'},
+  {',', '"', '\r', '\n'},
+  {'\t', '\n', '\r', '\\'},
+};
+
+struct SpecialTable {
+  bool table[3][256];
+
+  constexpr SpecialTable() : table() {
+    for (int i = 0; i < 0x20; ++i) {
+      table[kSpecialJson][i] = true;
+    }
+    for (int kind = 0; kind < 3; ++kind) {
+      for (char ch: kSpecialBytes[kind]) {
+        table[kind][(uint8_t) ch] = true;
+      }
+    }
+  }
+};
+
+constexpr SpecialTable kSpecial;
+
+// 返回第一个需要特殊处理的字节的下标, 没有返回 n
+// 大部分字段不需要转义, SSE2 每次检查 16 个字节
+template <SpecialKind kKind>
+size_t FindSpecial(const char* s, size_t n) {
+  size_t i = 0;
+#ifdef FQ_HAVE_SSE2
+  const char* bytes = kSpecialBytes[kKind];
+  const __m128i b0  = _mm_set1_epi8(bytes[0]);
+  const __m128i b1  = _mm_set1_epi8(bytes[1]);
+  const __m128i b2  = _mm_set1_epi8(bytes[2]);
+  const __m128i b3  = _mm_set1_epi8(bytes[3]);
+  for (; i + 16 <= n; i += 16) {
+    __m128i v   = _mm_loadu_si128((const __m128i*) (s + i));
+    __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, b0), _mm_cmpeq_epi8(v, b1)),
+                               _mm_or_si128(_mm_cmpeq_epi8(v, b2), _mm_cmpeq_epi8(v, b3)));
+    if (kKind == kSpecialJson) {
+      // 无符号 v <= 0x1f 等价于 min(v, 0x1f) == v
+      hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v));
+    }
+    unsigned mask = _mm_movemask_epi8(hit);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+  const bool* table = kSpecial.table[kKind];
+  for (; i < n; ++i) {
+    if (table[(uint8_t) s[i]]) {
+      return i;
+    }
+  }
+  return n;
+}
+
+// 加引号并转义, 连续不需要转义的部分整段拷贝
+void AppendJsonString(std::string_view value, std::string& out) {
+  static const char kHex[] = "0123456789abcdef";
+  out.push_back('"');
+  while (!value.empty()) {
+    size_t pos = FindSpecial<kSpecialJson>(value.data(), value.size());
+    out.append(value.data(), pos);
+    if (pos == value.size()) {
+      break;
+    }
+    char ch = value[pos];
+    // 常见的控制字符用短的形式
+    const char* escaped = nullptr;
+    switch (ch) {
+      case '"':
+        escaped = "\\\"";
+        break;
+      case '\\':
+        escaped = "\\\\";
+        break;
+      case '\n':
+        escaped = "\\n";
+        break;
+      case '\r':
+        escaped = "\\r";
+        break;
+      case '\t':
+        escaped = "\\t";
+        break;
+      case '\b':
+        escaped = "\\b";
+        break;
+      case '\f':
+        escaped = "\\f";
+        break;
+    }
+    if (escaped != nullptr) {
+      out.append(escaped, 2);
+    } else {
+      char unicode[6] = {'\\', 'u', '0', '0', kHex[(uint8_t) ch >> 4], kHex[ch & 0xf]};
+      out.append(unicode, 6);
+    }
+    value.remove_prefix(pos + 1);
+  }
+  out.push_back('"');
+}
+
+template <class T>
+void AppendNumber(T value, std::string& out) {
+  char buf[32];
+  auto ret = std::to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, ret.ptr - buf);
+}
+
+void AppendJsonValue(const ResultItem& item, std::string& out) {
+  switch (item.typed_.type) {
+    case kFieldTypeInt:
+      AppendNumber(item.typed_.i, out);
+      break;
+    case kFieldTypeUint:
+    case kFieldTypeHex:
+      AppendNumber(item.typed_.u, out);
+      break;
+    case kFieldTypeFloat:
+      // JSON 没有 inf 和 nan
+      if (std::isfinite(item.typed_.f)) {
+        AppendNumber(item.typed_.f, out);
+      } else {
+        out.append("null");
+      }
+      break;
+    case kFieldTypeBool:
+      out.append(item.typed_.b ? "true" : "false");
+      break;
+    default:
+      AppendJsonString(item.value_, out);
+  }
+}
+
+void AppendCsvField(std::string_view value, std::string& out) {
+  size_t pos = FindSpecial<kSpecialCsv>(value.data(), value.size());
+  if (pos == value.size()) {
+    out.append(value.data(), value.size());
+    return;
+  }
+  out.push_back('"');
+  // 第一个特殊字节之前不会有引号
+  out.append(value.data(), pos);
+  value.remove_prefix(pos);
+  while (!value.empty()) {
+    size_t quote = value.find('"');
+    if (quote == std::string_view::npos) {
+      out.append(value.data(), value.size());
+      break;
+    }
+    out.append(value.data(), quote + 1);
+    out.push_back('"');
+    value.remove_prefix(quote + 1);
+  }
+  out.push_back('"');
+}
+
+// 制表符, 换行, 回车和 '\\' 写为 \t \n \r \\, 与 PostgreSQL COPY 等加载工具的 text 格式一致
+void AppendTsvField(std::string_view value, std::string& out) {
+  while (!value.empty()) {
+    size_t pos = FindSpecial<kSpecialTsv>(value.data(), value.size());
+    out.append(value.data(), pos);
+    if (pos == value.size()) {
+      break;
+    }
+    char ch = value[pos];
+    out.push_back('\\');
+    out.push_back(ch == '\t' ? 't' : ch == '\n' ? 'n' : ch == '\r' ? 'r' : '\\');
+    value.remove_prefix(pos + 1);
+  }
+}
+
+}  // namespace
+
+void AppendTsvRecord(const MatchResult& result, std::string& out) {
+  for (int slot = 0; slot < result.Capacity(); ++slot) {
+    if (slot > 0) {
+      out.push_back('\t');
+    }
+    auto item = result.Get(slot);
+    if (item != nullptr) {
+      AppendTsvField(item->value_, out);
+    }
+  }
+  out.push_back('\n');
+}
+
+void AppendJsonRecord(const MatchResult& result, std::string& out) {
+  const NameTable* names = result.GetNameTable();
+  bool first = true;
+  out.push_back('{');
+  for (int slot = 0; slot < result.Capacity(); ++slot) {
+    auto item = result.Get(slot);
+    bool named = names != nullptr && slot < names->Size();
+    // 不在名字表中时不知道未设置字段的名字, 跳过
+    if (item == nullptr && !named) {
+      continue;
+    }
+    if (!first) {
+      out.push_back(',');
+    }
+    first = false;
+    AppendJsonString(named ? std::string_view(names->GetName(slot)) : item->name_, out);
+    out.push_back(':');
+    if (item != nullptr) {
+      AppendJsonValue(*item, out);
+    } else {
+      out.append("null");
+    }
+  }
+  out.append("}\n");
+}
+
+void AppendCsvRecord(const MatchResult& result, std::string& out) {
+  for (int slot = 0; slot < result.Capacity(); ++slot) {
+    if (slot > 0) {
+      out.push_back(',');
+    }
+    auto item = result.Get(slot);
+    if (item != nullptr) {
+      AppendCsvField(item->value_, out);
+    }
+  }
+  out.push_back('\n');
+}
+
+void AppendCsvHeader(const NameTable& names, std::string& out) {
+  for (int slot = 0; slot < names.Size(); ++slot) {
+    if (slot > 0) {
+      out.push_back(',');
+    }
+    AppendCsvField(names.GetName(slot), out);
+  }
+  out.push_back('\n');
+}
+
+int ParseOutputFormat(std::string_view name, OutputFormat& format) {
+  if (name == "tsv") {
+    format = kOutputTsv;
+  } else if (name == "jsonl") {
+    format = kOutputJsonl;
+  } else if (name == "csv") {
+    format = kOutputCsv;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+RecordAppender GetRecordAppender(OutputFormat format) {
+  switch (format) {
+    case kOutputJsonl:
+      return AppendJsonRecord;
+    case kOutputCsv:
+      return AppendCsvRecord;
+    default:
+      return AppendTsvRecord;
+  }
+}
+
+int BufferedWriter::Flush() {
+  int ret = Write(buffer_);
+  buffer_.clear();
+  return ret;
+}
+
+int BufferedWriter::Write(std::string_view s) {
+  while (!s.empty()) {
+    ssize_t n = write(fd_, s.data(), s.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    s.remove_prefix(n);
+  }
+  return 0;
+}
+
+}  // namespace fq
@@ -0,0 +1,89 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.28
+
+#pragma once
+#include <string>
+#include <string_view>
+#include "matcher.h"
+
+namespace fq {
+
+// 按 slot 顺序把一条记录追加到 out, 字段之间用 '\t' 分隔
+// 值中的 '\t', '\n', '\r', '\\' 转义为 \t \n \r \\, 保证一条记录一行
+void AppendTsvRecord(const MatchResult& result, std::string& out);
+
+// 一条记录一行 JSON 对象, key 按 slot 顺序
+// int/uint/hex/float/bool 字段写为 JSON 的数值和布尔值, 其余写为字符串; 未设置的字段为 null
+// 字符串只转义 '"', '\\' 和控制字符, 其他字节原样输出
+void AppendJsonRecord(const MatchResult& result, std::string& out);
+
+// RFC 4180: 含有 ',', '"', '\r', '\n' 的字段加引号, 引号写两次
+void AppendCsvRecord(const MatchResult& result, std::string& out);
+// 按 slot 顺序写字段名, 作为 CSV 的第一行
+void AppendCsvHeader(const NameTable& names, std::string& out);
+
+enum OutputFormat {
+  kOutputTsv   = 0,
+  kOutputJsonl = 1,
+  kOutputCsv   = 2,
+};
+
+using RecordAppender = void (*)(const MatchResult& result, std::string& out);
+
+// "tsv", "jsonl", "csv", 不认识返回 -1
+int ParseOutputFormat(std::string_view name, OutputFormat& format);
+RecordAppender GetRecordAppender(OutputFormat format);
+
+// 带缓冲的输出, 缓冲区满了才调用一次 write(2)
+class BufferedWriter {
+ public:
+  explicit BufferedWriter(int fd, size_t capacity = 1 << 20) : fd_(fd), capacity_(capacity) {
+    buffer_.reserve(capacity_);
+  }
+  ~BufferedWriter() { Flush(); }
+
+  BufferedWriter(const BufferedWriter&) = delete;
+  BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+  void Append(std::string_view s) {
+    if (buffer_.size() + s.size() > capacity_) {
+      Flush();
+      if (s.size() > capacity_) {
+        Write(s);
+        return;
+      }
+    }
+    buffer_.append(s.data(), s.size());
+  }
+  void Append(char ch) {
+    if (buffer_.size() + 1 > capacity_) {
+      Flush();
+    }
+    buffer_.push_back(ch);
+  }
+
+  // 按 slot 顺序输出一条记录, 默认格式同 AppendTsvRecord
+  void AppendRecord(const MatchResult& result, RecordAppender append = AppendTsvRecord) {
+    append(result, buffer_);
+    if (buffer_.size() >= capacity_) {
+      Flush();
+    }
+  }
+
+  // 成功返回 0, 写失败返回 -1
+  int Flush();
+
+ private:
+  int Write(std::string_view s);
+
+ private:
+  int fd_;
+  size_t capacity_;
+  std::string buffer_;
+};
+
+}  // namespace fq
@@ -0,0 +1,126 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.20
+
+#include "output_writer.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include "compiled_format.h"
+
+using namespace fq;
+
+// 逐字节转义, 用于对比
+static std::string NaiveJson(std::string_view s) {
+  std::string out = "\"";
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\') {
+      out += '\\';
+      out += ch;
+    } else if (ch == '\n') {
+      out += "\\n";
+    } else if (ch == '\t') {
+      out += "\\t";
+    } else if ((uint8_t) ch < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", (uint8_t) ch);
+      out += buf;
+    } else {
+      out += ch;
+    }
+  }
+  return out + "\"";
+}
+
+TEST(OutputWriter, Tsv)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{note}|{age:int}", compiled), 0);
+  MatchResult result;
+  ASSERT_TRUE(compiled.Match("Alice|tab\there\nnext\\line a long value that needs more than 16 bytes|18", result));
+  std::string out;
+  AppendTsvRecord(result, out);
+  EXPECT_EQ(out, "Alice\ttab\\there\\nnext\\\\line a long value that needs more than 16 bytes\t18\n");
+
+  ASSERT_TRUE(compiled.Match("a\r|plain|1", result));
+  out.clear();
+  AppendTsvRecord(result, out);
+  EXPECT_EQ(out, "a\\r\tplain\t1\n");
+}
+
+TEST(OutputWriter, Jsonl)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}|{score:float}|{ok:bool}|{id:hex}|{Raw({note})}", compiled), 0);
+  MatchResult result;
+  ASSERT_TRUE(compiled.Match("Al\"i\\ce|-18|12.5|true|0x1f|tab\there", result));
+  std::string out;
+  AppendJsonRecord(result, out);
+  EXPECT_EQ(out, "{\"name\":\"Al\\\"i\\\\ce\",\"age\":-18,\"score\":12.5,\"ok\":true,\"id\":31,\"note\":\"tab\\there\"}\n");
+
+  // 未设置的字段为 null
+  CompiledFormat optional;
+  ASSERT_EQ(parser.Parse("{a}|{b}", optional), 0);
+  result.Reset(&optional.GetNameTable());
+  result.Set(1, "b", "", "x");
+  out.clear();
+  AppendJsonRecord(result, out);
+  EXPECT_EQ(out, "{\"a\":null,\"b\":\"x\"}\n");
+
+  // 字符串字段与逐字节转义一致, 覆盖 SSE2 和剩余部分
+  std::mt19937 rng(42);
+  const char alphabet[] = "ab\"\\\n\t\x01\x1f\x7f\x80\xff,";
+  for (int i = 0; i < 2000; ++i) {
+    std::string s(rng() % 70, 'x');
+    for (auto& ch : s) {
+      if (rng() % 4 == 0) {
+        ch = alphabet[rng() % (sizeof(alphabet) - 1)];
+      }
+    }
+    result.Reset(nullptr);
+    result.Set(0, "s", "", s);
+    out.clear();
+    AppendJsonRecord(result, out);
+    ASSERT_EQ(out, "{\"s\":" + NaiveJson(s) + "}\n") << s;
+  }
+}
+
+TEST(OutputWriter, Csv)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{name}|{city}|{age:int}", compiled), 0);
+  std::string out;
+  AppendCsvHeader(compiled.GetNameTable(), out);
+  EXPECT_EQ(out, "name,city,age\n");
+
+  MatchResult result;
+  ASSERT_TRUE(compiled.Match("say \"hi\", Bob|Shenzhen|18", result));
+  out.clear();
+  AppendCsvRecord(result, out);
+  EXPECT_EQ(out, "\"say \"\"hi\"\", Bob\",Shenzhen,18\n");
+
+  ASSERT_TRUE(compiled.Match("a long name without specials|two\nlines|1", result));
+  out.clear();
+  AppendCsvRecord(result, out);
+  EXPECT_EQ(out, "a long name without specials,\"two\nlines\",1\n");
+
+  OutputFormat format;
+  EXPECT_EQ(ParseOutputFormat("csv", format), 0);
+  EXPECT_EQ(GetRecordAppender(format), AppendCsvRecord);
+  EXPECT_EQ(ParseOutputFormat("jsonl", format), 0);
+  EXPECT_EQ(GetRecordAppender(format), AppendJsonRecord);
+  EXPECT_EQ(ParseOutputFormat("tsv", format), 0);
+  EXPECT_EQ(GetRecordAppender(format), AppendTsvRecord);
+  EXPECT_EQ(ParseOutputFormat("xml", format), -1);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.30
+
+#include "parallel_matcher.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "match_lines.h"
+
+namespace fq {
+
+namespace {
+
+// 返回各块的边界, 第 i 块为 [bounds[i], bounds[i+1])
+std::vector<size_t> SplitChunks(std::string_view buffer, size_t chunk_size) {
+  std::vector<size_t> bounds{0};
+  size_t pos = 0;
+  while (pos < buffer.size()) {
+    size_t next = pos + chunk_size;
+    if (next >= buffer.size()) {
+      next = buffer.size();
+    } else {
+      auto newline = (const char*) memchr(buffer.data() + next, '\n', buffer.size() - next);
+      next = newline == nullptr ? buffer.size() : newline - buffer.data() + 1;
+    }
+    bounds.push_back(next);
+    pos = next;
+  }
+  return bounds;
+}
+
+}  // namespace
+
+size_t MatchParallel(const CompiledFormat& format, std::string_view buffer, const ParallelOptions& options,
+                     const RecordFormatter& formatter, const ChunkSink& sink) {
+  auto bounds   = SplitChunks(buffer, std::max<size_t>(options.chunk_size, 1));
+  size_t chunks = bounds.size() - 1;
+  if (chunks == 0) {
+    return 0;
+  }
+  size_t threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  threads        = std::min(threads, chunks);
+
+  struct Chunk {
+    std::string out;
+    bool done = false;
+  };
+  std::vector<Chunk> slots(options.ordered ? chunks : 0);
+  // 已经输出的块的缓冲, 还给工作线程复用, 避免每块都从空的 string 重新增长
+  std::vector<std::string> spare;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<size_t> next_chunk{0};
+  std::atomic<size_t> matched{0};
+  // 有序输出时, 已完成但还没输出的块最多 window 个, 避免输出全部堆积在内存中
+  size_t next_emit    = 0;
+  const size_t window = threads * 4;
+
+  auto worker = [&]() {
+    MatchResult result;
+    std::string out;
+    size_t local = 0;
+    while (true) {
+      size_t index = next_chunk.fetch_add(1);
+      if (index >= chunks) {
+        break;
+      }
+      if (options.ordered) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return index < next_emit + window; });
+      }
+      out.clear();
+      auto chunk = buffer.substr(bounds[index], bounds[index + 1] - bounds[index]);
+      local += MatchLines(format, chunk, result, [&](std::string_view, bool ok, const MatchResult& r) {
+        if (ok) {
+          formatter(r, out);
+        }
+      });
+      std::lock_guard<std::mutex> lock(mutex);
+      if (options.ordered) {
+        slots[index].out.swap(out);
+        slots[index].done = true;
+        if (!spare.empty()) {
+          out.swap(spare.back());
+          spare.pop_back();
+        }
+        cv.notify_all();
+      } else {
+        sink(out);
+      }
+    }
+    matched += local;
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    workers.emplace_back(worker);
+  }
+
+  if (options.ordered) {
+    std::string out;
+    for (size_t index = 0; index < chunks; ++index) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return slots[index].done; });
+        out.swap(slots[index].out);
+      }
+      sink(out);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        next_emit = index + 1;
+        spare.push_back(std::move(out));
+        out.clear();
+      }
+      cv.notify_all();
+    }
+  }
+
+  for (auto& t : workers) {
+    t.join();
+  }
+  return matched;
+}
+
+}  // namespace fq
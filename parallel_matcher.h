@@ -0,0 +1,36 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.03.30
+
+#pragma once
+#include <functional>
+#include <string>
+#include <string_view>
+#include "compiled_format.h"
+
+namespace fq {
+
+struct ParallelOptions {
+  // 工作线程数, 0 表示使用 CPU 核数
+  int threads = 0;
+  // 每块的大小, 实际边界会移动到下一个换行之后
+  size_t chunk_size = 4 << 20;
+  // true: 按输入顺序输出; false: 哪块先完成先输出
+  bool ordered = true;
+};
+
+// 每个匹配成功的行调用一次, 把记录追加到该块的输出 out 中, 在工作线程上执行
+using RecordFormatter = std::function<void(const MatchResult& result, std::string& out)>;
+// 每块完成后调用一次, 同一时刻只会有一个线程调用
+using ChunkSink = std::function<void(std::string_view out)>;
+
+// 把 buffer 按行边界切块后在多个线程上匹配
+// format 被所有线程只读共享, 每个线程有自己的 MatchResult 和输出缓冲
+// 返回匹配成功的行数
+size_t MatchParallel(const CompiledFormat& format, std::string_view buffer, const ParallelOptions& options,
+                     const RecordFormatter& formatter, const ChunkSink& sink);
+
+}  // namespace fq
@@ -0,0 +1,55 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.20
+
+#include "parallel_matcher.h"
+#include "match_lines.h"
+#include "matcher.h"
+#include "output_writer.h"
+#include <gtest/gtest.h>
+
+using namespace fq;
+
+TEST(MatchParallel, SameAsSequential)
+{
+  FormatParser parser;
+  CompiledFormat compiled;
+  ASSERT_EQ(parser.Parse("{id:int}|{name}", compiled), 0);
+
+  std::string buffer;
+  for (int i = 0; i < 10000; ++i) {
+    buffer += (i % 7 == 0) ? "bad line\n" : std::to_string(i) + "|name" + std::to_string(i) + "\n";
+  }
+  std::string expected;
+  MatchResult result;
+  size_t expected_matched = MatchLines(compiled, buffer, result, [&](std::string_view, bool ok, const MatchResult& r) {
+    if (ok) {
+      AppendTsvRecord(r, expected);
+    }
+  });
+
+  for (bool ordered : {true, false}) {
+    ParallelOptions options;
+    options.threads    = 4;
+    options.chunk_size = 1000;
+    options.ordered    = ordered;
+    std::string out;
+    size_t matched = MatchParallel(compiled, buffer, options, AppendTsvRecord, [&](std::string_view chunk) {
+      out.append(chunk.data(), chunk.size());
+    });
+    EXPECT_EQ(matched, expected_matched);
+    if (ordered) {
+      EXPECT_EQ(out, expected);
+    } else {
+      EXPECT_EQ(out.size(), expected.size());
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
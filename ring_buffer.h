@@ -0,0 +1,201 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.18
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace fq {
+
+// 避免与相邻数据共享 cache line
+constexpr size_t kCacheLine = 64;
+
+// 等待队列时的退避: 先自旋, 再让出 CPU, 最后睡眠, 空闲的流水线不会占满 CPU
+class Backoff {
+ public:
+  void Pause() {
+    if (count_ < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    } else if (count_ < 128) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      return;
+    }
+    ++count_;
+  }
+
+ private:
+  int count_ = 0;
+};
+
+inline size_t RoundUpPowerOfTwo(size_t n) {
+  size_t size = 2;
+  while (size < n) {
+    size <<= 1;
+  }
+  return size;
+}
+
+// 单生产者单消费者的有界队列
+// 生产者和消费者各自缓存对方的下标, 只有缓存的下标显示已满/已空时才读取对方的原子变量
+template <class T>
+class SpscRing {
+ public:
+  explicit SpscRing(size_t capacity)
+      : mask_(RoundUpPowerOfTwo(capacity) - 1), slots_(new T[mask_ + 1]) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  // 队列满时返回 false, value 不被移动
+  bool TryPush(T& value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+    value = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 队列满/空时等待, 即反压
+  void Push(T value) {
+    Backoff backoff;
+    while (!TryPush(value)) {
+      backoff.Pause();
+    }
+  }
+  void Pop(T& value) {
+    Backoff backoff;
+    while (!TryPop(value)) {
+      backoff.Pause();
+    }
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  const size_t mask_;
+  std::unique_ptr<T[]> slots_;
+  // 生产者使用
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+  // 消费者使用
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+};
+
+// 多生产者多消费者的有界队列, 也用于 SPMC/MPSC
+// 每个槽位带一个序号, 生产者和消费者通过 CAS 抢占下标后只访问自己的槽位 (Dmitry Vyukov 的算法)
+template <class T>
+class MpmcRing {
+ public:
+  explicit MpmcRing(size_t capacity) : mask_(RoundUpPowerOfTwo(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcRing(const MpmcRing&) = delete;
+  MpmcRing& operator=(const MpmcRing&) = delete;
+
+  // 队列满时返回 false, value 不被移动
+  bool TryPush(T& value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell         = &cells_[pos & mask_];
+      size_t seq   = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+      if (dif == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell         = &cells_[pos & mask_];
+      size_t seq   = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+      if (dif == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  void Push(T value) {
+    Backoff backoff;
+    while (!TryPush(value)) {
+      backoff.Pause();
+    }
+  }
+  void Pop(T& value) {
+    Backoff backoff;
+    while (!TryPop(value)) {
+      backoff.Pause();
+    }
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+};
+
+}  // namespace fq
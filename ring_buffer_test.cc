@@ -0,0 +1,93 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.18
+
+#include "ring_buffer.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace fq;
+
+TEST(SpscRing, PushPop)
+{
+  SpscRing<int> ring(3);
+  EXPECT_EQ(ring.Capacity(), 4u);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(ring.TryPush(i));
+  }
+  int value = 9;
+  EXPECT_FALSE(ring.TryPush(value));
+  EXPECT_EQ(value, 9);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(ring.TryPop(value));
+}
+
+TEST(SpscRing, Concurrent)
+{
+  const int n = 200000;
+  SpscRing<int> ring(64);
+  std::thread producer([&] {
+    for (int i = 0; i < n; ++i) {
+      ring.Push(i);
+    }
+  });
+  for (int i = 0; i < n; ++i) {
+    int value;
+    ring.Pop(value);
+    ASSERT_EQ(value, i);
+  }
+  producer.join();
+}
+
+TEST(MpmcRing, Concurrent)
+{
+  const int producers = 3, consumers = 3, n = 100000;
+  MpmcRing<int> ring(64);
+  std::vector<std::vector<int>> seen(consumers);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < n; ++i) {
+        ring.Push(p * n + i);
+      }
+    });
+  }
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&, c] {
+      for (int i = 0; i < n; ++i) {
+        int value;
+        ring.Pop(value);
+        seen[c].push_back(value);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // 每个值恰好出现一次, 同一个生产者的值在每个消费者中保持顺序
+  std::vector<int> count(producers * n, 0);
+  for (auto& values : seen) {
+    std::vector<int> last(producers, -1);
+    for (int value : values) {
+      ++count[value];
+      EXPECT_GT(value % n, last[value / n]);
+      last[value / n] = value % n;
+    }
+  }
+  for (int c : count) {
+    ASSERT_EQ(c, 1);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
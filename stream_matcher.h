@@ -0,0 +1,118 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.17
+
+#pragma once
+#include <string>
+#include <string_view>
+#include "compiled_format.h"
+#include "literal_search.h"
+
+namespace fq {
+
+// 按块输入的流式匹配, 块可以在任意位置切断, 记录以 '\n' 分隔, 规则同 MatchLines
+//
+//   StreamMatcher stream(format);
+//   while ((n = read(fd, buf, sizeof(buf))) > 0) {
+//     stream.Feed(std::string_view(buf, n), callback);
+//   }
+//   stream.Finish(callback);
+//
+// 完整落在块内的记录直接在块上匹配, 不拷贝; 只有跨越块边界的那一条记录被拷贝到内部缓冲区
+// callback(record, matched, result) 与 MatchLines 相同, record 和 result 只在调用期间有效
+// 超过 max_record 字节的记录不再缓存, 整条丢弃并计入 GetOverlong()
+class StreamMatcher {
+ public:
+  explicit StreamMatcher(const CompiledFormat& format, size_t max_record = 1 << 20)
+      : format_(format), max_record_(max_record) {}
+
+  StreamMatcher(const StreamMatcher&) = delete;
+  StreamMatcher& operator=(const StreamMatcher&) = delete;
+
+  // 返回本次匹配成功的记录数
+  template <class Callback>
+  size_t Feed(std::string_view chunk, Callback&& callback) {
+    static const LiteralSearcher newline("\n");
+    size_t matched = 0;
+    size_t end     = newline.Find(chunk);
+    if (end == LiteralSearcher::npos) {
+      Carry(chunk);
+      return 0;
+    }
+
+    // 上一块留下的半条记录到这里结束
+    if (!carry_.empty() || skipping_) {
+      Carry(chunk.substr(0, end));
+      if (!skipping_) {
+        matched += Emit(carry_, callback);
+      }
+      carry_.clear();
+      skipping_ = false;
+    } else {
+      matched += Emit(chunk.substr(0, end), callback);
+    }
+
+    size_t pos = end + 1;
+    while ((end = newline.Find(chunk, pos)) != LiteralSearcher::npos) {
+      matched += Emit(chunk.substr(pos, end - pos), callback);
+      pos = end + 1;
+    }
+    Carry(chunk.substr(pos));
+    return matched;
+  }
+
+  // 输入结束, 匹配最后一条没有 '\n' 的记录
+  template <class Callback>
+  size_t Finish(Callback&& callback) {
+    size_t matched = 0;
+    if (!carry_.empty() && !skipping_) {
+      matched = Emit(carry_, callback);
+    }
+    carry_.clear();
+    skipping_ = false;
+    return matched;
+  }
+
+  // 当前缓存的半条记录的长度
+  size_t GetCarrySize() const { return carry_.size(); }
+  size_t GetOverlong() const { return overlong_; }
+
+ private:
+  void Carry(std::string_view s) {
+    if (skipping_) {
+      return;
+    }
+    if (carry_.size() + s.size() > max_record_) {
+      carry_.clear();
+      skipping_ = true;
+      ++overlong_;
+      return;
+    }
+    carry_.append(s.data(), s.size());
+  }
+
+  template <class Callback>
+  size_t Emit(std::string_view record, Callback& callback) {
+    if (!record.empty() && record.back() == '\r') {
+      record.remove_suffix(1);
+    }
+    bool ok = format_.Match(record, result_);
+    callback(record, ok, result_);
+    return ok ? 1 : 0;
+  }
+
+ private:
+  const CompiledFormat& format_;
+  size_t max_record_;
+  MatchResult result_;
+  // 跨越块边界的半条记录
+  std::string carry_;
+  // 当前记录超长, 丢弃到下一个 '\n'
+  bool skipping_   = false;
+  size_t overlong_ = 0;
+};
+
+}  // namespace fq
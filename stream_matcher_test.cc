@@ -0,0 +1,88 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.17
+
+#include "stream_matcher.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include "match_lines.h"
+
+using namespace fq;
+
+namespace {
+
+struct Record {
+  std::string line;
+  bool matched;
+  std::string age;
+
+  bool operator==(const Record& other) const {
+    return line == other.line && matched == other.matched && age == other.age;
+  }
+};
+
+auto Collect(std::vector<Record>& records) {
+  return [&records](std::string_view line, bool matched, const MatchResult& result) {
+    auto age = result.Get("age");
+    records.push_back(Record{std::string(line), matched, matched ? std::string(age->value_) : ""});
+  };
+}
+
+}  // namespace
+
+TEST(StreamMatcher, SameAsMatchLines)
+{
+  FormatParser parser;
+  CompiledFormat format;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", format), 0);
+  std::string buffer = "Alice|18\nbad\r\n\nBob|20\r\nCarol|x\nDave|42";
+
+  std::vector<Record> expected;
+  MatchResult result;
+  size_t expected_matched = MatchLines(format, buffer, result, Collect(expected));
+
+  // 在每一对位置切成三块
+  for (size_t i = 0; i <= buffer.size(); ++i) {
+    for (size_t j = i; j <= buffer.size(); ++j) {
+      StreamMatcher stream(format);
+      std::vector<Record> records;
+      size_t matched = stream.Feed(std::string_view(buffer).substr(0, i), Collect(records));
+      matched += stream.Feed(std::string_view(buffer).substr(i, j - i), Collect(records));
+      matched += stream.Feed(std::string_view(buffer).substr(j), Collect(records));
+      matched += stream.Finish(Collect(records));
+      EXPECT_EQ(matched, expected_matched) << i << " " << j;
+      EXPECT_EQ(records, expected) << i << " " << j;
+      EXPECT_EQ(stream.GetCarrySize(), 0u);
+    }
+  }
+}
+
+TEST(StreamMatcher, CarryOnlyStraddlingRecord)
+{
+  FormatParser parser;
+  CompiledFormat format;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", format), 0);
+  StreamMatcher stream(format, 16);
+  std::vector<Record> records;
+
+  EXPECT_EQ(stream.Feed("Alice|18\nBob|2", Collect(records)), 1u);
+  EXPECT_EQ(stream.GetCarrySize(), 5u);
+  EXPECT_EQ(stream.Feed("0\nCarol|3", Collect(records)), 1u);
+  EXPECT_EQ(records.back().age, "20");
+
+  // 超长的记录整条丢弃
+  EXPECT_EQ(stream.Feed("0000000000000000", Collect(records)), 0u);
+  EXPECT_EQ(stream.GetOverlong(), 1u);
+  EXPECT_EQ(stream.Feed("000\nDave|42\n", Collect(records)), 1u);
+  EXPECT_EQ(records.size(), 3u);
+  EXPECT_EQ(records.back().line, "Dave|42");
+  EXPECT_EQ(stream.Finish(Collect(records)), 0u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,201 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.18
+
+#include "stream_pipeline.h"
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "match_lines.h"
+#include "output_writer.h"
+#include "ring_buffer.h"
+
+namespace fq {
+
+namespace {
+
+struct Batch {
+  uint64_t seq = 0;
+  // 若干条完整的记录, 最后一块可能没有结尾的 '\n'
+  std::string data;
+  std::string out;
+};
+
+// 读到 data 末尾, 返回读到的字节数, 0 表示结尾, -1 表示失败
+ssize_t ReadBlock(int fd, std::string& data, size_t block_size) {
+  size_t old = data.size();
+  data.resize(old + block_size);
+  ssize_t n;
+  do {
+    n = read(fd, &data[old], block_size);
+  } while (n < 0 && errno == EINTR);
+  data.resize(old + std::max<ssize_t>(n, 0));
+  return n;
+}
+
+}  // namespace
+
+int MatchStream(const CompiledFormat& format, int in_fd, int out_fd, const PipelineOptions& options,
+                const RecordFormatter& formatter, size_t* matched, size_t* overlong) {
+  const int threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  // 读线程总是持有一块, 至少需要两块
+  const size_t count = std::max(options.batches > 0 ? (size_t) options.batches : (size_t) threads * 4, (size_t) 2);
+  const size_t block = std::max<size_t>(options.block_size, 1);
+
+  std::vector<Batch> batches(count);
+  // nullptr 表示结束, 每个匹配线程一个
+  MpmcRing<Batch*> work(count + threads);
+  MpmcRing<Batch*> done(count + threads);
+  SpscRing<Batch*> idle(count);
+  for (auto& batch: batches) {
+    idle.Push(&batch);
+  }
+
+  std::atomic<size_t> total{0};
+  auto worker = [&]() {
+    MatchResult result;
+    size_t local = 0;
+    Batch* batch;
+    while (true) {
+      work.Pop(batch);
+      if (batch == nullptr) {
+        break;
+      }
+      batch->out.clear();
+      local += MatchLines(format, batch->data, result, [&](std::string_view line, bool ok, const MatchResult& r) {
+        if (ok) {
+          formatter(r, batch->out);
+        }
+      });
+      done.Push(batch);
+    }
+    total += local;
+    done.Push(nullptr);
+  };
+
+  int write_ret = 0;
+  auto writer = [&]() {
+    BufferedWriter out(out_fd);
+    // 有序输出时, 序号为 seq 的块放在 pending[seq % count]; 在途的块不超过 count 个, 不会冲突
+    std::vector<Batch*> pending(count, nullptr);
+    uint64_t next = 0;
+    int ends      = 0;
+    Batch* batch;
+    while (ends < threads) {
+      if (!done.TryPop(batch)) {
+        if (out.Flush() != 0) {
+          write_ret = -1;
+        }
+        done.Pop(batch);
+      }
+      if (batch == nullptr) {
+        ++ends;
+        continue;
+      }
+      if (!options.ordered) {
+        out.Append(batch->out);
+        idle.Push(batch);
+        continue;
+      }
+      pending[batch->seq % count] = batch;
+      while ((batch = pending[next % count]) != nullptr && batch->seq == next) {
+        out.Append(batch->out);
+        pending[next % count] = nullptr;
+        idle.Push(batch);
+        ++next;
+      }
+    }
+    if (out.Flush() != 0) {
+      write_ret = -1;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back(worker);
+  }
+  std::thread writer_thread(writer);
+
+  int read_ret = 0;
+  uint64_t seq = 0;
+  // 跨越多次 read 的记录超过 max_record 时丢弃到下一个 '\n'
+  const size_t max_record = std::max<size_t>(options.max_record, 1);
+  bool skipping  = false;
+  size_t dropped = 0;
+  Batch* cur;
+  idle.Pop(cur);
+  cur->data.clear();
+  while (true) {
+    size_t old = cur->data.size();
+    ssize_t n  = ReadBlock(in_fd, cur->data, block);
+    if (n <= 0) {
+      read_ret = n < 0 ? -1 : 0;
+      break;
+    }
+    // 之前的部分没有 '\n', 只在新读到的部分中找
+    std::string_view fresh(cur->data.data() + old, n);
+    if (skipping) {
+      // 丢弃时 data 已清空, old 为 0
+      size_t first = fresh.find('\n');
+      if (first == std::string::npos) {
+        cur->data.clear();
+        continue;
+      }
+      cur->data.erase(0, first + 1);
+      fresh    = cur->data;
+      skipping = false;
+    }
+    size_t last = fresh.rfind('\n');
+    if (last == std::string::npos) {
+      if (cur->data.size() > max_record) {
+        cur->data.clear();
+        skipping = true;
+        ++dropped;
+      }
+      continue;
+    }
+    last += cur->data.size() - fresh.size();
+    Batch* next;
+    idle.Pop(next);
+    next->data.assign(cur->data, last + 1, std::string::npos);
+    cur->data.resize(last + 1);
+    cur->seq = seq++;
+    work.Push(cur);
+    cur = next;
+    if (cur->data.size() > max_record) {
+      cur->data.clear();
+      skipping = true;
+      ++dropped;
+    }
+  }
+  // 最后一条记录可能没有 '\n'
+  cur->seq = seq++;
+  work.Push(cur);
+  for (int i = 0; i < threads; ++i) {
+    work.Push(nullptr);
+  }
+
+  for (auto& t: workers) {
+    t.join();
+  }
+  writer_thread.join();
+  if (matched != nullptr) {
+    *matched = total;
+  }
+  if (overlong != nullptr) {
+    *overlong = dropped;
+  }
+  if (read_ret != 0) {
+    return read_ret;
+  }
+  return write_ret == 0 ? 0 : -2;
+}
+
+}  // namespace fq
@@ -0,0 +1,38 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.18
+
+#pragma once
+#include <cstddef>
+#include "compiled_format.h"
+#include "parallel_matcher.h"
+
+namespace fq {
+
+struct PipelineOptions {
+  // 匹配线程数, 0 表示使用 CPU 核数
+  int threads = 0;
+  // 每次 read(2) 的大小
+  size_t block_size = 1 << 20;
+  // 同时在流水线中的块数, 0 表示 threads * 4; 所有块都在使用时读线程等待, 即反压
+  int batches = 0;
+  // true: 按输入顺序输出; false: 哪块先完成先输出
+  bool ordered = true;
+  // 跨越多次 read 的记录的最大长度, 超过时整条丢弃, 保证没有 '\n' 的输入也只占用有限的内存
+  size_t max_record = 1 << 20;
+};
+
+// 从 in_fd 读到结尾, 匹配成功的记录经 formatter 格式化后写到 out_fd, 适用于管道等不能 mmap 的输入
+//   读线程(调用线程): 按 block_size 读, 在最后一个 '\n' 处切块, 只有跨块的半条记录被拷贝到下一块
+//   匹配线程: 从 SPMC 队列取块, 用 MatchLines 匹配, 放入 MPSC 队列
+//   写线程: 按块的序号恢复顺序, 用 BufferedWriter 合并成大块 write(2); 暂时没有新块时立即写出, 保证延迟
+// 用过的块经 SPSC 队列还给读线程, 稳定后没有内存分配
+// 返回 0 成功, -1 读失败, -2 写失败; matched 不为 nullptr 时保存匹配成功的行数
+// overlong 不为 nullptr 时保存因超过 max_record 被丢弃的记录数
+int MatchStream(const CompiledFormat& format, int in_fd, int out_fd, const PipelineOptions& options,
+                const RecordFormatter& formatter, size_t* matched = nullptr, size_t* overlong = nullptr);
+
+}  // namespace fq
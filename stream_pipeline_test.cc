@@ -0,0 +1,120 @@
+// Copyright (c) 2022, Tencent Inc.
+//
+// All rights reserved.
+//
+// Author: linghuimeng<linghuimeng@tencent.com>
+// Date: 2022.04.18
+
+#include "stream_pipeline.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include "match_lines.h"
+#include "output_writer.h"
+
+using namespace fq;
+
+namespace {
+
+// 通过管道把 input 交给 MatchStream, 一次写 step 个字节, 返回输出
+std::string RunPipe(const CompiledFormat& format, const std::string& input, const PipelineOptions& options,
+                    size_t step, size_t* matched, size_t* overlong = nullptr) {
+  int in[2], out[2];
+  EXPECT_EQ(pipe(in), 0);
+  EXPECT_EQ(pipe(out), 0);
+  std::thread feeder([&] {
+    for (size_t pos = 0; pos < input.size(); pos += step) {
+      EXPECT_EQ(write(in[1], input.data() + pos, std::min(step, input.size() - pos)),
+                (ssize_t) std::min(step, input.size() - pos));
+    }
+    close(in[1]);
+  });
+  std::string output;
+  std::thread drainer([&] {
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(out[0], buf, sizeof(buf))) > 0) {
+      output.append(buf, n);
+    }
+  });
+  EXPECT_EQ(MatchStream(format, in[0], out[1], options, AppendTsvRecord, matched, overlong), 0);
+  close(out[1]);
+  feeder.join();
+  drainer.join();
+  close(in[0]);
+  close(out[0]);
+  return output;
+}
+
+}  // namespace
+
+TEST(MatchStream, SameAsMatchLines)
+{
+  FormatParser parser;
+  CompiledFormat format;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", format), 0);
+  std::string input;
+  for (int i = 0; i < 20000; ++i) {
+    input += i % 7 == 0 ? "bad line\n" : "user" + std::to_string(i) + "|" + std::to_string(i) + "\n";
+  }
+  input += "last|1";
+
+  std::string expected;
+  MatchResult result;
+  size_t expected_matched = MatchLines(format, input, result, [&](std::string_view, bool ok, const MatchResult& r) {
+    if (ok) {
+      AppendTsvRecord(r, expected);
+    }
+  });
+
+  for (int threads : {1, 3}) {
+    for (size_t block : {7, 4096}) {
+      PipelineOptions options;
+      options.threads    = threads;
+      options.block_size = block;
+      options.batches    = 2;
+      size_t matched     = 0;
+      EXPECT_EQ(RunPipe(format, input, options, 1000, &matched), expected) << threads << " " << block;
+      EXPECT_EQ(matched, expected_matched);
+    }
+  }
+
+  // 无序输出时内容相同
+  PipelineOptions options;
+  options.threads    = 3;
+  options.block_size = 512;
+  options.ordered    = false;
+  std::string output = RunPipe(format, input, options, 333, nullptr);
+  EXPECT_EQ(output.size(), expected.size());
+}
+
+TEST(MatchStream, DropOverlongRecord)
+{
+  FormatParser parser;
+  CompiledFormat format;
+  ASSERT_EQ(parser.Parse("{name}|{age:int}", format), 0);
+  // 8MB 没有 '\n' 的数据夹在两条正常记录之间, 结尾再来一段没有 '\n' 的
+  std::string blob(8 << 20, 'x');
+  std::string input = "a|1\n" + blob + "|2\nb|3\n" + blob;
+
+  PipelineOptions options;
+  options.threads    = 2;
+  options.block_size = 64 << 10;
+  options.max_record = 256 << 10;
+  size_t matched = 0, overlong = 0;
+  EXPECT_EQ(RunPipe(format, input, options, 1 << 20, &matched, &overlong), "a\t1\nb\t3\n");
+  EXPECT_EQ(matched, 2u);
+  EXPECT_EQ(overlong, 2u);
+
+  // 不超过 max_record 的长记录正常匹配
+  options.max_record = 16 << 20;
+  EXPECT_EQ(RunPipe(format, input, options, 1 << 20, &matched, &overlong), "a\t1\n" + blob + "\t2\nb\t3\n");
+  EXPECT_EQ(matched, 3u);
+  EXPECT_EQ(overlong, 0u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
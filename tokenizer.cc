@@ -8,12 +8,39 @@
 #include "tokenizer.h"
 namespace fq {
 
-Tokenizer::Tokenizer(const std::string& pattern, bool debug) : pattern_(pattern), debug_(debug) {
-  inner_mode_.push(kLiteralMode);
+namespace {
+
+enum CharClass : uint8_t {
+  kCharId    = 1,  // [a-zA-Z0-9_<>+-]
+  kCharWhite = 2,  // ' ' '\t' '\n'
+};
+
+struct CharTable {
+  uint8_t value[256];
+
+  constexpr CharTable() : value() {
+    const char id[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890_<>+-";
+    for (int i = 0; id[i] != '\0'; ++i) {
+      value[(uint8_t) id[i]] |= kCharId;
+    }
+    value[(uint8_t) ' '] |= kCharWhite;
+    value[(uint8_t) '\t'] |= kCharWhite;
+    value[(uint8_t) '\n'] |= kCharWhite;
+  }
+
+  bool Is(char ch, CharClass c) const { return (value[(uint8_t) ch] & c) != 0; }
+};
+
+constexpr CharTable kChars;
+
+}  // namespace
+
+Tokenizer::Tokenizer(std::string_view pattern, bool debug) : pattern_(pattern), debug_(debug) {
+  Push(kLiteralMode);
 }
 
 Token Tokenizer::TryGetNext() {
-  TokenizerMode mode = inner_mode_.top();
+  TokenizerMode mode = Top();
   if (mode == kLiteralMode || mode == kLimitLiteralModeBrace || mode == kLimitLiteralMode) {
     return GetNextLiteralToken();
   }
@@ -28,31 +55,31 @@ Token Tokenizer::TryGetNext() {
 
 // any char until
 Token Tokenizer::GetNextLiteralToken() {
-  TokenizerMode mode = inner_mode_.top();
+  TokenizerMode mode = Top();
   int pos            = pos_;
   while (pos < pattern_.size()) {
     char ch = pattern_[pos];
     if (ch == '{' || ch == '}' ||
         ((mode == kLimitLiteralModeBrace or mode == kLimitLiteralMode) && (ch == '(' || ch == ')' || ch == ','))) {
       if (pos == pos_) {
-        Token ret(std::string(1, ch), pos_, kTokenTypeSymbol);
+        Token ret(pattern_.substr(pos_, 1), pos_, kTokenTypeSymbol);
         pos_ += 1;
         // mode switch outer
         if (ch == '{') {
-          inner_mode_.push(kMatchMode);
+          Push(kMatchMode);
         }
         if (mode == kLimitLiteralModeBrace && ch == ')') {
           // mode = kLimitLiteralMode;
-          inner_mode_.pop();
-          // assert inner_mode_.top() == kLimitLiteralMode
+          Pop();
+          // assert Top() == kLimitLiteralMode
         }
         if (mode == kLimitLiteralMode && ch == ',') {
-          inner_mode_.pop();  // mode = kMatchParamsMode;
+          Pop();  // mode = kMatchParamsMode;
         }
         if (mode == kLimitLiteralMode && ch == ')') {
           // mode = kMatchMode;
-          inner_mode_.pop();  // to kMatchParamsMode
-          inner_mode_.pop();  // to kMatchMode
+          Pop();  // to kMatchParamsMode
+          Pop();  // to kMatchMode
         }
 
         return ret;
@@ -80,25 +107,23 @@ Token Tokenizer::GetNextLiteralToken() {
 // {Decl(...)}
 // {name:type:Decl(...)}
 Token Tokenizer::GetNextMatchToken() {
-  TokenizerMode mode = inner_mode_.top();
+  TokenizerMode mode = Top();
   SkipWhite();
 
-  static std::string id_token_s = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890_<>+-";
-  static std::set<char> id_token{id_token_s.begin(), id_token_s.end()};
   int pos = pos_;
   while (pos < pattern_.size()) {
     char ch = pattern_[pos];
-    if (id_token.count(ch) == 0) {
+    if (!kChars.Is(ch, kCharId)) {
       if (pos == pos_) {
-        Token ret(std::string(1, ch), pos_, kTokenTypeSymbol);
+        Token ret(pattern_.substr(pos_, 1), pos_, kTokenTypeSymbol);
         pos_ += 1;
         // tryGetNextState
         if (mode == kMatchMode && ch == '(') {
           // mode = kMatchParamsMode;
-          inner_mode_.push(kMatchParamsMode);
+          Push(kMatchParamsMode);
         }
         if (mode == kMatchMode && ch == '}') {
-          inner_mode_.pop();
+          Pop();
           // mode = kLiteralMode; // 只能pop 要不如不知道哪里进来的
         }
         return ret;
@@ -114,23 +139,28 @@ Token Tokenizer::GetNextMatchToken() {
       pos += 1;
     }
   }
+  // 没有结束的 {name, 返回最后的 ID, 否则 pos_ 不前进, 调用方会一直循环
+  if (pos > pos_) {
+    Token ret(pattern_.substr(pos_, pos - pos_), pos_, kTokenTypeIdentifier);
+    pos_ = pos;
+    return ret;
+  }
   return Token("", pos_, kTokenTypeEOF);
 }
 
 Token Tokenizer::GetNextTokenInParamsList() {
   SkipWhite();
-  inner_mode_.push(kLimitLiteralMode);
-  char start_char = pattern_[pos_];
+  Push(kLimitLiteralMode);
+  char start_char = pos_ < (int) pattern_.size() ? pattern_[pos_] : '\0';
   if (start_char == '(') {
-    inner_mode_.push(kLimitLiteralModeBrace);
+    Push(kLimitLiteralModeBrace);
   }
   return GetNextLiteralToken();
 }
 
 void Tokenizer::SkipWhite() {
   while (pos_ < pattern_.size()) {
-    char ch = pattern_[pos_];
-    if (ch == ' ' || ch == '\t' || ch == '\n') {
+    if (kChars.Is(pattern_[pos_], kCharWhite)) {
       pos_ += 1;
     } else {
       break;
@@ -6,12 +6,11 @@
 // Date: 2022.03.14
 
 #pragma once
-#include <map>
-#include <memory>
-#include <set>
-#include <stack>
+#include <cstdint>
+#include <cstdio>
 #include <string>
-#include <vector>
+#include <string_view>
+#include "match_stats.h"
 
 namespace fq {
 
@@ -23,49 +22,61 @@ enum TokenType {
   kTokenTypeEOF        = 4,  // 空
 };
 
+// token 只是 format 文本的视图, 文本由 Tokenizer 的调用方保存(见 FormatRootNode::SaveText)
 class Token {
  public:
   Token() {}
-  Token(std::string s, int pos, TokenType type) : empty(false), token_(s), pos_(pos), type_(type) {}
+  Token(std::string_view s, int pos, TokenType type) : empty(false), token_(s), pos_(pos), type_(type) {}
 
-  std::string GetString() { return token_; }
-  TokenType GetType() { return type_; }
-  int GetPos() { return pos_; }
+  std::string_view GetString() const { return token_; }
+  TokenType GetType() const { return type_; }
+  int GetPos() const { return pos_; }
 
-  bool IsEmpty() { return empty; }
+  bool IsEmpty() const { return empty; }
 
   std::string Repr() { return ""; }
 
-  bool operator==(const Token& other) { return token_ == other.token_ && pos_ == other.pos_ && type_ == other.type_; }
+  bool operator==(const Token& other) const {
+    return token_ == other.token_ && pos_ == other.pos_ && type_ == other.type_;
+  }
 
  private:
   bool empty = true;
-  std::string token_;
+  std::string_view token_;
   int pos_;
   TokenType type_;
 };
 
 class Tokenizer {
  public:
-  Tokenizer(const std::string& pattern, bool debug = false);
+  // pattern 不会被拷贝, 必须比 Tokenizer 和返回的 Token 活得久
+  Tokenizer(std::string_view pattern, bool debug = false);
 
   Token GetNext() {
-    TokenizerMode before = inner_mode_.top();
-    last_                = TryGetNext();
-    TokenizerMode after  = inner_mode_.top();
-    if (debug_) {
-      printf("[#%d->%d] GetToken: Token(\"%s\", %d, %d)\n",
-             before,
-             after,
-             last_.GetString().c_str(),
-             last_.GetPos(),
-             last_.GetType());
+    FQ_STAT_ADD(kStatTokens, 1);
+    if (!debug_) {
+      last_ = TryGetNext();
+      return last_;
     }
+    TokenizerMode before = Top();
+    last_                = TryGetNext();
+    TokenizerMode after  = Top();
+    printf("[#%d->%d] GetToken: Token(\"%.*s\", %d, %d)\n",
+           before,
+           after,
+           (int) last_.GetString().size(),
+           last_.GetString().data(),
+           last_.GetPos(),
+           last_.GetType());
     return last_;
   }
 
   Token GetLast() { return last_; }
-  bool HasNext() { return pos_ < pattern_.size(); }
+  // 模式栈溢出之后不再返回 token
+  bool HasNext() { return pos_ < (int) pattern_.size() && !overflow_; }
+
+  // 模式栈的最大深度, 每层 decl 大约需要 4 层
+  static constexpr int kMaxModeDepth = 160;
 
  private:
   Token TryGetNext();
@@ -111,12 +122,28 @@ class Tokenizer {
   };
 
   // 需要切分的原始字符串
-  std::string pattern_;
+  std::string_view pattern_;
   // 当前处理位置
   int pos_ = 0;
 
-  // 切分模式
-  std::stack<TokenizerMode> inner_mode_;
+  // 切分模式, 固定大小的栈, 不分配内存
+  TokenizerMode Top() const { return (TokenizerMode) modes_[depth_ - 1]; }
+  void Push(TokenizerMode mode) {
+    if (depth_ == kMaxModeDepth) {
+      overflow_ = true;
+      return;
+    }
+    modes_[depth_++] = (uint8_t) mode;
+  }
+  void Pop() {
+    if (depth_ > 1) {
+      --depth_;
+    }
+  }
+
+  uint8_t modes_[kMaxModeDepth];
+  int depth_     = 0;
+  bool overflow_ = false;
 
   // 上一个token
   Token last_;
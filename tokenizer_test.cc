@@ -7,6 +7,7 @@
 
 #include "tokenizer.h"
 #include <gtest/gtest.h>
+#include "matcher.h"
 
 using namespace fq;
 
@@ -133,6 +134,99 @@ TEST(Tokenizer, HandleRecurentMatch5)
   EXPECT_EQ(tokenizer.HasNext(), false);
 }
 
+TEST(Tokenizer, CharClass)
+{
+  // ID 字符为 [a-zA-Z0-9_<>+-]
+  Tokenizer id("{aZ09_<>+-}");
+  EXPECT_EQ(id.GetNext(), Token("{", 0, kTokenTypeSymbol));
+  EXPECT_EQ(id.GetNext(), Token("aZ09_<>+-", 1, kTokenTypeIdentifier));
+  EXPECT_EQ(id.GetNext(), Token("}", 10, kTokenTypeSymbol));
+  EXPECT_EQ(id.HasNext(), false);
+
+  // 其他字符单独成为符号
+  Tokenizer symbol("{a.b}");
+  EXPECT_EQ(symbol.GetNext(), Token("{", 0, kTokenTypeSymbol));
+  EXPECT_EQ(symbol.GetNext(), Token("a", 1, kTokenTypeIdentifier));
+  EXPECT_EQ(symbol.GetNext(), Token(".", 2, kTokenTypeSymbol));
+  EXPECT_EQ(symbol.GetNext(), Token("b", 3, kTokenTypeIdentifier));
+
+  // 空白只有 ' ' '\t' '\n', '\r' 不是空白
+  Tokenizer white("{ \t\nname\n}{\rx}");
+  EXPECT_EQ(white.GetNext(), Token("{", 0, kTokenTypeSymbol));
+  EXPECT_EQ(white.GetNext(), Token("name", 4, kTokenTypeIdentifier));
+  EXPECT_EQ(white.GetNext(), Token("}", 9, kTokenTypeSymbol));
+  EXPECT_EQ(white.GetNext(), Token("{", 10, kTokenTypeSymbol));
+  EXPECT_EQ(white.GetNext(), Token("\r", 11, kTokenTypeSymbol));
+  EXPECT_EQ(white.GetNext(), Token("x", 12, kTokenTypeIdentifier));
+}
+
+// 每个 "{a(" 使模式栈加深 3 层, 参数中的文本再加 1 层
+static std::string DeepPattern(const std::string& tail) {
+  std::string pattern;
+  for (int i = 0; i < Tokenizer::kMaxModeDepth / 3; ++i) {
+    pattern += "{a(";
+  }
+  return pattern + tail;
+}
+
+TEST(Tokenizer, MaxModeDepth)
+{
+  static_assert(Tokenizer::kMaxModeDepth % 3 == 1, "DeepPattern assumes depth 3k + 1");
+
+  // 恰好达到 kMaxModeDepth, 所有 token 都能取到
+  std::string full = DeepPattern("x");
+  Tokenizer tokenizer(full);
+  Token last;
+  while (tokenizer.HasNext()) {
+    last = tokenizer.GetNext();
+  }
+  EXPECT_EQ(last, Token("x", (int) full.size() - 1, kTokenTypeLiteral));
+
+  // 再深一层溢出, 之后不再返回 token
+  std::string over = DeepPattern("{b}");
+  Tokenizer overflow(over);
+  while (overflow.HasNext()) {
+    last = overflow.GetNext();
+  }
+  EXPECT_EQ(last, Token("{", (int) over.size() - 3, kTokenTypeSymbol));
+}
+
+TEST(Tokenizer, ParseMalformed)
+{
+  // 每个前缀都应该能解析结束: 字段完整时返回 0, 否则返回错误
+  std::string format = "{name:str}:{Raw({age:int}|{sex})},{FKV((&),=,{k})}";
+  int depth = 0;
+  for (size_t size = 0; size <= format.size(); ++size) {
+    if (size > 0) {
+      depth += format[size - 1] == '{';
+      depth -= format[size - 1] == '}';
+    }
+    FormatParser parser;
+    FormatRootNode root;
+    int ret = parser.Parse(format.substr(0, size), root);
+    if (depth == 0) {
+      EXPECT_EQ(ret, 0) << format.substr(0, size);
+    } else {
+      EXPECT_LT(ret, 0) << format.substr(0, size);
+    }
+  }
+  FormatParser parser;
+  FormatRootNode root;
+  EXPECT_EQ(parser.Parse("{name", root), -4);
+
+  // 模式栈溢出
+  std::string deep;
+  for (int i = 0; i < 100; ++i) {
+    deep += "{Raw(";
+  }
+  deep += "{a}";
+  for (int i = 0; i < 100; ++i) {
+    deep += ")}";
+  }
+  FormatRootNode deep_root;
+  EXPECT_EQ(parser.Parse(deep, deep_root), -4);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -1,20 +1,110 @@
 // Copyright (c) 2021, Tencent Inc.
 // Author: linghuimeng<linghuimeng@tencent.com>
 // Create Time: 2022.03.14
-// Description: 
+// Description:
 
 
-#include "<gflags/gflags.h>"
+#include <gflags/gflags.h>
+#include <unistd.h>
+#include "compiled_format.h"
+#include "mapped_file.h"
+#include "match_stats.h"
+#include "match_lines.h"
 #include "matcher.h"
+#include "output_writer.h"
+#include "parallel_matcher.h"
+#include "stream_pipeline.h"
 DEFINE_string(format, "", "format");
 DEFINE_string(source, "", "source");
+DEFINE_string(input, "", "input file, matched line by line, matched fields are written to stdout; - for stdin");
+DEFINE_int32(threads, 1, "matcher threads for --input, 0 means one per core");
+DEFINE_bool(unordered, false, "with --threads, write records in completion order instead of input order");
+DEFINE_string(output, "tsv", "record format for --input: tsv, jsonl or csv");
+DEFINE_bool(stats, false, "print match statistics to stderr, needs a build with -DFQ_ENABLE_STATS");
 
 using namespace fq;
 
+int MatchInput(const CompiledFormat& format) {
+  OutputFormat output;
+  if (ParseOutputFormat(FLAGS_output, output) != 0) {
+    fprintf(stderr, "unknown output %s\n", FLAGS_output.c_str());
+    return 1;
+  }
+  RecordAppender append = GetRecordAppender(output);
+  std::string header;
+  if (output == kOutputCsv) {
+    AppendCsvHeader(format.GetNameTable(), header);
+  }
+
+  if (FLAGS_input == "-") {
+    // 管道不能 mmap, 读/匹配/写分别在不同线程上流水线执行
+    PipelineOptions options;
+    options.threads = FLAGS_threads;
+    options.ordered = !FLAGS_unordered;
+    {
+      BufferedWriter writer(STDOUT_FILENO);
+      writer.Append(header);
+      if (writer.Flush() != 0) {
+        return 1;
+      }
+    }
+    size_t overlong = 0;
+    int ret = MatchStream(format, STDIN_FILENO, STDOUT_FILENO, options, append, nullptr, &overlong);
+    if (overlong > 0) {
+      fprintf(stderr, "dropped %zu records longer than %zu bytes\n", overlong, options.max_record);
+    }
+    if (ret != 0) {
+      fprintf(stderr, "MatchStream ret=%d\n", ret);
+      return 1;
+    }
+    return 0;
+  }
+
+  MappedFile file;
+  int ret = file.Open(FLAGS_input);
+  if (ret != 0) {
+    fprintf(stderr, "Open %s ret=%d\n", FLAGS_input.c_str(), ret);
+    return 1;
+  }
+
+  BufferedWriter writer(STDOUT_FILENO);
+  writer.Append(header);
+  if (FLAGS_threads != 1) {
+    ParallelOptions options;
+    options.threads = FLAGS_threads;
+    options.ordered = !FLAGS_unordered;
+    MatchParallel(format, file.Data(), options, append, [&](std::string_view out) { writer.Append(out); });
+    return writer.Flush() == 0 ? 0 : 1;
+  }
+
+  MatchResult result;
+  MatchLines(format, file.Data(), result, [&](std::string_view line, bool matched, const MatchResult& result) {
+    if (matched) {
+      writer.AppendRecord(result, append);
+    }
+  });
+  return writer.Flush() == 0 ? 0 : 1;
+}
 
 int main(int argc, char** argv) {
   google::ParseCommandLineFlags(&argc, &argv, false);
 
+  if (!FLAGS_input.empty()) {
+    FormatParser parser;
+    CompiledFormat format;
+    int ret = parser.Parse(FLAGS_format, format);
+    if (ret != 0) {
+      fprintf(stderr, "Parse %s ret=%d\n", FLAGS_format.c_str(), ret);
+      return 1;
+    }
+    ret = MatchInput(format);
+    if (FLAGS_stats) {
+      GetMatchStats().Print(stderr);
+      format.PrintStats(stderr, FLAGS_format);
+    }
+    return ret;
+  }
+
   FormatParser parser(true);
   FormatRootNode root;
   int ret = parser.Parse(FLAGS_format, root);
@@ -26,11 +116,9 @@ int main(int argc, char** argv) {
   bool h = root.Handle(FLAGS_source, 0, FLAGS_source.size(), result);
   printf("handle result = %d\n", h);
   result.Dump();
+  if (FLAGS_stats) {
+    GetMatchStats().Print(stderr);
+  }
 
   return 0;
 }
-
-
-
-
-